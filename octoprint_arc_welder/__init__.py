@@ -110,6 +110,21 @@ class ArcWelderPlugin(
             g90_g91_influences_extruder=False,
             resolution_mm=0.05,
             max_radius_mm=1000*1000,  # 1KM, pretty big :)
+            use_fixed_point=False,
+            use_least_squares_fit=False,
+            use_lookahead=False,
+            use_segment_optimizer=False,
+            allow_helical_arcs=False,
+            allow_travel_arcs=False,
+            allow_g0_travel_arcs=False,
+            use_line_simplification=False,
+            remove_redundant_commands=False,
+            minify_gcode=False,
+            minify_gcode_remove_spaces=False,
+            allow_r_arcs=False,
+            allow_bezier_curves=False,
+            min_segments=3,
+            max_segments=45,
             overwrite_source_file=False,
             target_prefix="",
             target_postfix=".aw",
@@ -390,6 +405,111 @@ class ArcWelderPlugin(
             max_radius_mm = self.settings_default["max_radius_mm"]
         return max_radius_mm
 
+    @property
+    def _use_fixed_point(self):
+        use_fixed_point = self._settings.get_boolean(["use_fixed_point"])
+        if use_fixed_point is None:
+            use_fixed_point = self.settings_default["use_fixed_point"]
+        return use_fixed_point
+
+    @property
+    def _use_least_squares_fit(self):
+        use_least_squares_fit = self._settings.get_boolean(["use_least_squares_fit"])
+        if use_least_squares_fit is None:
+            use_least_squares_fit = self.settings_default["use_least_squares_fit"]
+        return use_least_squares_fit
+
+    @property
+    def _use_lookahead(self):
+        use_lookahead = self._settings.get_boolean(["use_lookahead"])
+        if use_lookahead is None:
+            use_lookahead = self.settings_default["use_lookahead"]
+        return use_lookahead
+
+    @property
+    def _use_segment_optimizer(self):
+        use_segment_optimizer = self._settings.get_boolean(["use_segment_optimizer"])
+        if use_segment_optimizer is None:
+            use_segment_optimizer = self.settings_default["use_segment_optimizer"]
+        return use_segment_optimizer
+
+    @property
+    def _allow_helical_arcs(self):
+        allow_helical_arcs = self._settings.get_boolean(["allow_helical_arcs"])
+        if allow_helical_arcs is None:
+            allow_helical_arcs = self.settings_default["allow_helical_arcs"]
+        return allow_helical_arcs
+
+    @property
+    def _allow_travel_arcs(self):
+        allow_travel_arcs = self._settings.get_boolean(["allow_travel_arcs"])
+        if allow_travel_arcs is None:
+            allow_travel_arcs = self.settings_default["allow_travel_arcs"]
+        return allow_travel_arcs
+
+    @property
+    def _allow_g0_travel_arcs(self):
+        allow_g0_travel_arcs = self._settings.get_boolean(["allow_g0_travel_arcs"])
+        if allow_g0_travel_arcs is None:
+            allow_g0_travel_arcs = self.settings_default["allow_g0_travel_arcs"]
+        return allow_g0_travel_arcs
+
+    @property
+    def _use_line_simplification(self):
+        use_line_simplification = self._settings.get_boolean(["use_line_simplification"])
+        if use_line_simplification is None:
+            use_line_simplification = self.settings_default["use_line_simplification"]
+        return use_line_simplification
+
+    @property
+    def _remove_redundant_commands(self):
+        remove_redundant_commands = self._settings.get_boolean(["remove_redundant_commands"])
+        if remove_redundant_commands is None:
+            remove_redundant_commands = self.settings_default["remove_redundant_commands"]
+        return remove_redundant_commands
+
+    @property
+    def _minify_gcode(self):
+        minify_gcode = self._settings.get_boolean(["minify_gcode"])
+        if minify_gcode is None:
+            minify_gcode = self.settings_default["minify_gcode"]
+        return minify_gcode
+
+    @property
+    def _minify_gcode_remove_spaces(self):
+        minify_gcode_remove_spaces = self._settings.get_boolean(["minify_gcode_remove_spaces"])
+        if minify_gcode_remove_spaces is None:
+            minify_gcode_remove_spaces = self.settings_default["minify_gcode_remove_spaces"]
+        return minify_gcode_remove_spaces
+
+    @property
+    def _allow_r_arcs(self):
+        allow_r_arcs = self._settings.get_boolean(["allow_r_arcs"])
+        if allow_r_arcs is None:
+            allow_r_arcs = self.settings_default["allow_r_arcs"]
+        return allow_r_arcs
+
+    @property
+    def _allow_bezier_curves(self):
+        allow_bezier_curves = self._settings.get_boolean(["allow_bezier_curves"])
+        if allow_bezier_curves is None:
+            allow_bezier_curves = self.settings_default["allow_bezier_curves"]
+        return allow_bezier_curves
+
+    @property
+    def _min_segments(self):
+        min_segments = self._settings.get_int(["min_segments"])
+        if min_segments is None:
+            min_segments = self.settings_default["min_segments"]
+        return min_segments
+
+    @property
+    def _max_segments(self):
+        max_segments = self._settings.get_int(["max_segments"])
+        if max_segments is None:
+            max_segments = self.settings_default["max_segments"]
+        return max_segments
+
     @property
     def _overwrite_source_file(self):
         overwrite_source_file = self._settings.get_boolean(["overwrite_source_file"])
@@ -448,6 +568,21 @@ class ArcWelderPlugin(
             "resolution_mm": self._resolution_mm,
             "max_radius_mm": self._max_radius_mm,
             "g90_g91_influences_extruder": self._g90_g91_influences_extruder,
+            "use_fixed_point": self._use_fixed_point,
+            "use_least_squares_fit": self._use_least_squares_fit,
+            "use_lookahead": self._use_lookahead,
+            "use_segment_optimizer": self._use_segment_optimizer,
+            "allow_helical_arcs": self._allow_helical_arcs,
+            "allow_travel_arcs": self._allow_travel_arcs,
+            "allow_g0_travel_arcs": self._allow_g0_travel_arcs,
+            "use_line_simplification": self._use_line_simplification,
+            "remove_redundant_commands": self._remove_redundant_commands,
+            "minify_gcode": self._minify_gcode,
+            "minify_gcode_remove_spaces": self._minify_gcode_remove_spaces,
+            "allow_r_arcs": self._allow_r_arcs,
+            "allow_bezier_curves": self._allow_bezier_curves,
+            "min_segments": self._min_segments,
+            "max_segments": self._max_segments,
             "log_level": self._gcode_conversion_log_level
         }
 
@@ -486,11 +621,23 @@ class ArcWelderPlugin(
             "source_file_total_count": progress["source_file_total_count"],
             "target_file_total_count": progress["target_file_total_count"],
             "segment_statistics_text": progress["segment_statistics_text"],
+            "shape_statistics_text": progress["shape_statistics_text"],
             "seconds_elapsed": progress["seconds_elapsed"],
             "gcodes_processed": progress["gcodes_processed"],
             "lines_processed": progress["lines_processed"],
             "points_compressed": progress["points_compressed"],
             "arcs_created": progress["arcs_created"],
+            "lines_simplified": progress["lines_simplified"],
+            "line_points_compressed": progress["line_points_compressed"],
+            "redundant_moves_removed": progress["redundant_moves_removed"],
+            "redundant_feedrates_removed": progress["redundant_feedrates_removed"],
+            "redundant_axes_removed": progress["redundant_axes_removed"],
+            "redundant_fan_commands_removed": progress["redundant_fan_commands_removed"],
+            "redundant_g92_commands_removed": progress["redundant_g92_commands_removed"],
+            "r_arcs_written": progress["r_arcs_written"],
+            "r_arc_bytes_saved": progress["r_arc_bytes_saved"],
+            "curves_created": progress["curves_created"],
+            "curve_points_compressed": progress["curve_points_compressed"],
             "source_file_size": progress["source_file_size"],
             "source_file_position": progress["source_file_position"],
             "target_file_size": progress["target_file_size"],
@@ -609,10 +756,40 @@ class ArcWelderPlugin(
             "\n\tsource_file_path: %s"
             "\n\tresolution_mm: %.3f"
             "\n\tg90_g91_influences_extruder: %r"
+            "\n\tuse_fixed_point: %r"
+            "\n\tuse_least_squares_fit: %r"
+            "\n\tuse_lookahead: %r"
+            "\n\tuse_segment_optimizer: %r"
+            "\n\tallow_helical_arcs: %r"
+            "\n\tallow_travel_arcs: %r"
+            "\n\tallow_g0_travel_arcs: %r"
+            "\n\tuse_line_simplification: %r"
+            "\n\tremove_redundant_commands: %r"
+            "\n\tminify_gcode: %r"
+            "\n\tminify_gcode_remove_spaces: %r"
+            "\n\tallow_r_arcs: %r"
+            "\n\tallow_bezier_curves: %r"
+            "\n\tmin_segments: %d"
+            "\n\tmax_segments: %d"
             "\n\tlog_level: %d",
             preprocessor_args["path"],
             preprocessor_args["resolution_mm"],
             preprocessor_args["g90_g91_influences_extruder"],
+            preprocessor_args["use_fixed_point"],
+            preprocessor_args["use_least_squares_fit"],
+            preprocessor_args["use_lookahead"],
+            preprocessor_args["use_segment_optimizer"],
+            preprocessor_args["allow_helical_arcs"],
+            preprocessor_args["allow_travel_arcs"],
+            preprocessor_args["allow_g0_travel_arcs"],
+            preprocessor_args["use_line_simplification"],
+            preprocessor_args["remove_redundant_commands"],
+            preprocessor_args["minify_gcode"],
+            preprocessor_args["minify_gcode_remove_spaces"],
+            preprocessor_args["allow_r_arcs"],
+            preprocessor_args["allow_bezier_curves"],
+            preprocessor_args["min_segments"],
+            preprocessor_args["max_segments"],
             preprocessor_args["log_level"]
         )
 
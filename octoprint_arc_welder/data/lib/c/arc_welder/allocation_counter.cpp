@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+
+#include "allocation_counter.h"
+#include <sstream>
+#ifdef ARC_WELDER_COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+allocation_stage allocation_counter::stage = allocation_stage_other;
+long long allocation_counter::counts[ALLOCATION_STAGE_COUNT] = { 0 };
+
+static void* count_and_allocate(std::size_t size)
+{
+	allocation_counter::counts[allocation_counter::stage]++;
+	void* p = std::malloc(size == 0 ? 1 : size);
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new(std::size_t size)
+{
+	return count_and_allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return count_and_allocate(size);
+}
+
+void operator delete(void* p) throw()
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+	std::free(p);
+}
+#endif
+
+bool allocation_counter::is_enabled()
+{
+#ifdef ARC_WELDER_COUNT_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+void allocation_counter::reset()
+{
+#ifdef ARC_WELDER_COUNT_ALLOCATIONS
+	for (int index = 0; index < ALLOCATION_STAGE_COUNT; index++)
+	{
+		counts[index] = 0;
+	}
+#endif
+}
+
+allocation_counts allocation_counter::get_counts()
+{
+	allocation_counts result;
+#ifdef ARC_WELDER_COUNT_ALLOCATIONS
+	for (int index = 0; index < ALLOCATION_STAGE_COUNT; index++)
+	{
+		result.counts[index] = counts[index];
+	}
+#endif
+	return result;
+}
+
+void allocation_counts::clear()
+{
+	for (int index = 0; index < ALLOCATION_STAGE_COUNT; index++)
+	{
+		counts[index] = 0;
+	}
+}
+
+long long allocation_counts::get_total() const
+{
+	long long total = 0;
+	for (int index = 0; index < ALLOCATION_STAGE_COUNT; index++)
+	{
+		total += counts[index];
+	}
+	return total;
+}
+
+allocation_counts allocation_counts::operator-(const allocation_counts& other) const
+{
+	allocation_counts result;
+	for (int index = 0; index < ALLOCATION_STAGE_COUNT; index++)
+	{
+		result.counts[index] = counts[index] - other.counts[index];
+	}
+	return result;
+}
+
+std::string allocation_counts::str() const
+{
+	std::stringstream stream;
+	stream << "Total: " << get_total();
+	for (int index = 0; index < ALLOCATION_STAGE_COUNT; index++)
+	{
+		stream << ", " << allocation_stage_names[index] << ": " << counts[index];
+	}
+	return stream.str();
+}
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+
+#pragma once
+#include <string>
+
+// Build with ARC_WELDER_COUNT_ALLOCATIONS defined (see COUNT_ALLOCATIONS in setup.py) to replace the global operator new
+// and count the allocations made in each stage of the arc welder pipeline.  Without it, none of this does anything.
+// The counters are not thread safe, so this is only meant for profiling.
+
+enum allocation_stage {
+	allocation_stage_other = 0,
+	allocation_stage_read = 1,
+	allocation_stage_parse = 2,
+	allocation_stage_position = 3,
+	allocation_stage_arc = 4,
+	allocation_stage_write = 5,
+	allocation_stage_progress = 6
+};
+#define ALLOCATION_STAGE_COUNT 7
+static const char* const allocation_stage_names[ALLOCATION_STAGE_COUNT] = { "other", "read", "parse", "position", "arc", "write", "progress" };
+
+struct allocation_counts
+{
+	allocation_counts()
+	{
+		clear();
+	}
+	long long counts[ALLOCATION_STAGE_COUNT];
+	void clear();
+	long long get_total() const;
+	allocation_counts operator-(const allocation_counts& other) const;
+	std::string str() const;
+};
+
+class allocation_counter
+{
+public:
+	static bool is_enabled();
+	static void reset();
+	static allocation_counts get_counts();
+#ifdef ARC_WELDER_COUNT_ALLOCATIONS
+	static allocation_stage stage;
+	static long long counts[ALLOCATION_STAGE_COUNT];
+#endif
+};
+
+// Sets the stage that allocations are counted against until it goes out of scope.
+class allocation_stage_scope
+{
+public:
+#ifdef ARC_WELDER_COUNT_ALLOCATIONS
+	allocation_stage_scope(allocation_stage stage)
+	{
+		previous_stage_ = allocation_counter::stage;
+		allocation_counter::stage = stage;
+	}
+	~allocation_stage_scope()
+	{
+		allocation_counter::stage = previous_stage_;
+	}
+private:
+	allocation_stage previous_stage_;
+#else
+	allocation_stage_scope(allocation_stage /*stage*/)
+	{
+	}
+#endif
+};
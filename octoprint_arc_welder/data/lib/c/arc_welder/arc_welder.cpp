@@ -25,6 +25,10 @@
 #if _MSC_VER > 1200
 #define _CRT_SECURE_NO_DEPRECATE
 #endif
+#ifndef _MSC_VER
+// Use a 64 bit off_t for stat on 32 bit platforms too
+#define _FILE_OFFSET_BITS 64
+#endif
 
 #include "arc_welder.h"
 #include <vector>
@@ -34,23 +38,62 @@
 #include <fstream>
 #include <iomanip>
 #include <sstream>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 
-arc_welder::arc_welder(std::string source_path, std::string target_path, logger * log, double resolution_mm, double max_radius, bool g90_g91_influences_extruder, int buffer_size, progress_callback callback) : current_arc_(DEFAULT_MIN_SEGMENTS, buffer_size - 5, resolution_mm, max_radius), segment_statistics_(segment_statistic_lengths, segment_statistic_lengths_count, log)
+arc_welder::arc_welder(arc_welder_args args) : segment_statistics_(segment_statistic_lengths, segment_statistic_lengths_count, args.log), current_arc_(args.min_segments, args.max_segments, args.resolution_mm, args.max_radius_mm, args.use_least_squares_fit, args.use_lookahead, args.use_segment_optimizer, args.allow_helical_arcs), commands_to_reprocess_(args.max_segments + GCODE_BUFFER_EXTRA_SIZE), window_commands_(args.max_segments + GCODE_BUFFER_EXTRA_SIZE), current_shape_arc_(args.min_segments, args.max_segments, args.resolution_mm, args.max_radius_mm, args.use_least_squares_fit), current_line_(args.max_segments, args.resolution_mm), current_curve_(args.min_segments, args.max_segments, args.resolution_mm), shape_commands_(args.max_segments), pending_shape_commands_(args.max_segments + 1)
 {
-	p_logger_ = log;
+	p_logger_ = args.log;
 	debug_logging_enabled_ = false;
 	info_logging_enabled_ = false;
 	error_logging_enabled_ = false;
 	verbose_logging_enabled_ = false;
 
 	logger_type_ = 0;
-	progress_callback_ = callback;
+	progress_callback_ = args.callback;
 	verbose_output_ = false;
-	source_path_ = source_path;
-	target_path_ = target_path;
-	resolution_mm_ = resolution_mm;
-	gcode_position_args_ = get_args_(g90_g91_influences_extruder, buffer_size);
+	source_path_ = args.source_path;
+	target_path_ = args.target_path;
+	resolution_mm_ = args.resolution_mm;
+	use_fixed_point_ = args.use_fixed_point;
+	allow_travel_arcs_ = args.allow_travel_arcs;
+	allow_g0_travel_arcs_ = args.allow_travel_arcs && args.allow_g0_travel_arcs;
+	is_g0_arc_ = false;
+	use_line_simplification_ = args.use_line_simplification;
+	remove_redundant_commands_ = args.remove_redundant_commands;
+	minify_gcode_ = args.minify_gcode;
+	minify_gcode_remove_spaces_ = args.minify_gcode && args.minify_gcode_remove_spaces;
+	minify_max_error_fixed_ = utilities::to_fixed(args.resolution_mm * MINIFY_GCODE_MAX_ERROR_RATIO);
+	parameter_format_.is_minified = minify_gcode_;
+	parameter_format_.include_spaces = !minify_gcode_remove_spaces_;
+	parameter_format_.max_error_fixed = minify_max_error_fixed_;
+	allow_r_arcs_ = args.allow_r_arcs;
+	r_arc_max_path_error_ = args.resolution_mm * R_ARC_MAX_PATH_ERROR_RATIO;
+	// Arc end points have 3 decimals, which are truncated unless fixed point is used, and minified values may be
+	// rounded further.
+	r_arc_start_error_ = args.use_fixed_point ? 0.0005 : 0.001;
+	if (minify_gcode_ && utilities::from_fixed(minify_max_error_fixed_) > r_arc_start_error_)
+	{
+		r_arc_start_error_ = utilities::from_fixed(minify_max_error_fixed_);
+	}
+	allow_bezier_curves_ = args.allow_bezier_curves;
+	// The competitors are listed in the order they win ties
+	shape_competitor_count_ = 0;
+	is_arc_competing_ = (allow_bezier_curves_ || use_line_simplification_) && !args.use_segment_optimizer;
+	if (is_arc_competing_)
+	{
+		add_shape_competitor_(SHAPE_TYPE_ARC, &current_shape_arc_);
+	}
+	if (allow_bezier_curves_)
+	{
+		add_shape_competitor_(SHAPE_TYPE_CURVE, &current_curve_);
+	}
+	if (use_line_simplification_)
+	{
+		add_shape_competitor_(SHAPE_TYPE_LINE, &current_line_);
+	}
+	gcode_position_args_ = get_args_(args.g90_g91_influences_extruder, args.max_segments + GCODE_BUFFER_EXTRA_SIZE);
 	notification_period_seconds = 1;
 	lines_processed_ = 0;
 	gcodes_processed_ = 0;
@@ -58,7 +101,19 @@ arc_welder::arc_welder(std::string source_path, std::string target_path, logger
 	last_gcode_line_written_ = 0;
 	points_compressed_ = 0;
 	arcs_created_ = 0;
+	redundant_moves_removed_ = 0;
+	redundant_feedrates_removed_ = 0;
+	redundant_axes_removed_ = 0;
+	redundant_fan_commands_removed_ = 0;
+	redundant_g92_commands_removed_ = 0;
+	r_arcs_written_ = 0;
+	r_arc_bytes_saved_ = 0;
+	has_previous_fan_command_ = false;
+	is_e_position_known_ = false;
+	unreliable_parameters_ = PARAMETER_NONE;
 	waiting_for_arc_ = false;
+	is_reprocessing_ = false;
+	fit_seconds_ = 0;
 	previous_feedrate_ = -1;
 	previous_is_extruder_relative_ = false;
 	gcode_position_args_.set_num_extruders(8);
@@ -81,6 +136,7 @@ gcode_position_args arc_welder::get_args_(bool g90_g91_influences_extruder, int
 	// Configure gcode_position_args
 	args.g90_influences_extruder = g90_g91_influences_extruder;
 	args.position_buffer_size = buffer_size;
+	args.motion_only = true;
 	args.autodetect_position = true;
 	args.home_x = 0;
 	args.home_x_none = true;
@@ -127,18 +183,50 @@ void arc_welder::reset()
 	file_size_ = 0;
 	points_compressed_ = 0;
 	arcs_created_ = 0;
+	redundant_moves_removed_ = 0;
+	redundant_feedrates_removed_ = 0;
+	redundant_axes_removed_ = 0;
+	redundant_fan_commands_removed_ = 0;
+	redundant_g92_commands_removed_ = 0;
+	r_arcs_written_ = 0;
+	r_arc_bytes_saved_ = 0;
+	has_previous_fan_command_ = false;
+	is_e_position_known_ = false;
+	unreliable_parameters_ = PARAMETER_NONE;
 	waiting_for_arc_ = false;
+	commands_to_reprocess_.clear();
+	shape_commands_.clear();
+	pending_shape_commands_.clear();
+	shape_statistics_ = shape_competition_statistics();
+	for (int index = 0; index < shape_competitor_count_; index++)
+	{
+		shape_competitor& competitor = shape_competitors_[index];
+		competitor.p_shape->clear();
+		competitor.num_commands = 0;
+		competitor.is_growing = false;
+		shape_statistics_.shapes[competitor.type].is_enabled = true;
+	}
+	is_reprocessing_ = false;
+	fit_seconds_ = 0;
 }
 
-long arc_welder::get_file_size(const std::string& file_path)
+long long arc_welder::get_file_size(const std::string& file_path)
 {
-	// Todo:  Fix this function.  This is a pretty weak implementation :(
-	std::ifstream file(file_path.c_str(), std::ios::in | std::ios::binary);
-	const long l = (long)file.tellg();
-	file.seekg(0, std::ios::end);
-	const long m = (long)file.tellg();
-	file.close();
-	return (m - l);
+	// Get the size from the file system rather than seeking, and make sure it is 64 bit everywhere
+#ifdef _MSC_VER
+	struct _stat64 file_stat;
+	if (_stat64(file_path.c_str(), &file_stat) != 0)
+	{
+		return 0;
+	}
+#else
+	struct stat file_stat;
+	if (stat(file_path.c_str(), &file_stat) != 0)
+	{
+		return 0;
+	}
+#endif
+	return static_cast<long long>(file_stat.st_size);
 }
 
 double arc_welder::get_next_update_time() const
@@ -165,7 +253,22 @@ arc_welder_results results;
 	stream << "arc_welder::process - Parameters received: source_file_path: '" <<
 		source_path_ << "', target_file_path:'" << target_path_ << "', resolution_mm:" <<
 		resolution_mm_ << "mm (+-" << current_arc_.get_resolution_mm() << "mm), max_radius_mm:" << current_arc_.get_max_radius()
-		 << "mm, g90_91_influences_extruder: " << (p_source_position_->get_g90_91_influences_extruder() ? "True" : "False");
+		 << "mm, g90_91_influences_extruder: " << (p_source_position_->get_g90_91_influences_extruder() ? "True" : "False")
+		 << ", use_fixed_point: " << (use_fixed_point_ ? "True" : "False")
+		 << ", use_least_squares_fit: " << (current_arc_.get_use_least_squares_fit() ? "True" : "False")
+		 << ", use_lookahead: " << (current_arc_.get_use_lookahead() ? "True" : "False")
+		 << ", use_segment_optimizer: " << (current_arc_.get_use_segment_optimizer() ? "True" : "False")
+		 << ", allow_helical_arcs: " << (current_arc_.get_allow_helical_arcs() ? "True" : "False")
+		 << ", allow_travel_arcs: " << (allow_travel_arcs_ ? "True" : "False")
+		 << ", allow_g0_travel_arcs: " << (allow_g0_travel_arcs_ ? "True" : "False")
+		 << ", use_line_simplification: " << (use_line_simplification_ ? "True" : "False")
+		 << ", remove_redundant_commands: " << (remove_redundant_commands_ ? "True" : "False")
+		 << ", minify_gcode: " << (minify_gcode_ ? "True" : "False")
+		 << ", minify_gcode_remove_spaces: " << (minify_gcode_remove_spaces_ ? "True" : "False")
+		 << ", allow_r_arcs: " << (allow_r_arcs_ ? "True" : "False")
+		 << ", allow_bezier_curves: " << (allow_bezier_curves_ ? "True" : "False")
+		 << ", min_segments: " << current_arc_.get_min_segments()
+		 << ", max_segments: " << current_arc_.get_max_segments();
 	p_logger_->log(logger_type_, INFO, stream.str());
 
 
@@ -184,6 +287,10 @@ arc_welder_results results;
 	stream.str("");
 	stream << "Source file size: " << file_size_;
 	p_logger_->log(logger_type_, DEBUG, stream.str());
+	stream.clear();
+	stream.str("");
+	stream << "Position size: " << sizeof(position) << " bytes, command size: " << sizeof(parsed_command) << " bytes.";
+	p_logger_->log(logger_type_, DEBUG, stream.str());
 	// Create the source file read stream and target write stream
 	std::ifstream gcodeFile;
 	p_logger_->log(logger_type_, DEBUG, "Opening the source file for reading.");
@@ -216,11 +323,50 @@ arc_welder_results results;
 	add_arcwelder_comment_to_target();
 	
 	parsed_command cmd;
+	// Allocations made while reading are counted against the read stage unless a narrower stage is set below.
+	allocation_counter::reset();
+	allocation_stage_scope read_scope(allocation_stage_read);
+	allocation_counts warm_up_allocations;
+	allocation_counts steady_state_allocations;
 	// Communicate every second
 	p_logger_->log(logger_type_, DEBUG, "Processing source file.");
+	// The end marker of the comment block currently being copied, or NULL if we are not in a block
+	const char* comment_block_end = NULL;
 	while (std::getline(gcodeFile, line) && continue_processing)
 	{
 		lines_processed_++;
+		if (lines_processed_ == ALLOCATION_WARM_UP_LINES)
+		{
+			warm_up_allocations = allocation_counter::get_counts();
+		}
+
+		if (comment_block_end != NULL)
+		{
+			// Thumbnails and settings can be thousands of lines, copy them without parsing or tracking the position.
+			if (is_comment_line(line))
+			{
+				append_comment_line(line, comment_block_buffer_);
+				// The parser counts any text before the semicolon (whitespace included) as gcode, do the same here.
+				if (line.length() > 0 && line[0] != ';')
+				{
+					gcodes_processed_++;
+				}
+				std::string::size_type comment_start = line.find(';');
+				if (comment_start != std::string::npos && comment_starts_with(line.c_str() + comment_start + 1, comment_block_end))
+				{
+					write_comment_block_to_file();
+					comment_block_end = NULL;
+				}
+				else if (comment_block_buffer_.length() > COMMENT_BLOCK_MAX_BUFFER_SIZE)
+				{
+					write_comment_block_to_file();
+				}
+				continue;
+			}
+			// This isn't a comment, so the block ended without a marker.  Process the line normally.
+			write_comment_block_to_file();
+			comment_block_end = NULL;
+		}
 
 		cmd.clear();
 		if (verbose_logging_enabled_)
@@ -230,7 +376,10 @@ arc_welder_results results;
 			stream << "Parsing: " << line;
 			p_logger_->log(logger_type_, VERBOSE, stream.str());
 		}
-		parser_.try_parse_gcode(line.c_str(), cmd, true);
+		{
+			allocation_stage_scope parse_scope(allocation_stage_parse);
+			parser_.try_parse_gcode(line.c_str(), cmd, true);
+		}
 		bool has_gcode = false;
 		if (cmd.gcode.length() > 0)
 		{
@@ -245,7 +394,16 @@ arc_welder_results results;
 		// Always process the command through the printer, even if no command is found
 		// This is important so that comments can be analyzed
 		//std::cout << "stabilization::process_file - updating position...";
-		process_gcode(cmd, false, false);
+		{
+			allocation_stage_scope arc_scope(allocation_stage_arc);
+			process_gcode(cmd, false, false);
+		}
+
+		// See if this comment starts a block we can copy directly.  All gcodes are written at this point unless we are waiting for an arc.
+		if (!has_gcode && !waiting_for_arc_ && cmd.comment.length() > 0)
+		{
+			comment_block_end = get_comment_block_end(cmd.comment);
+		}
 
 		// Only continue to process if we've found a command and either a progress_callback_ is supplied, or debug loggin is enabled.
 		if (has_gcode && (progress_callback_ != NULL || info_logging_enabled_))
@@ -256,22 +414,35 @@ arc_welder_results results;
 				{
 					p_logger_->log(logger_type_, VERBOSE, "Sending progress update.");
 				}
-				continue_processing = on_progress_(get_progress_(static_cast<long>(gcodeFile.tellg()), static_cast<double>(start_clock)));
+				allocation_stage_scope progress_scope(allocation_stage_progress);
+				continue_processing = on_progress_(get_progress_(static_cast<long long>(gcodeFile.tellg()), static_cast<double>(start_clock)));
 				next_update_time = get_next_update_time();
 			}
 		}
 	}
 
-	if (current_arc_.is_shape() && waiting_for_arc_)
+	if (lines_processed_ >= ALLOCATION_WARM_UP_LINES)
+	{
+		steady_state_allocations = allocation_counter::get_counts() - warm_up_allocations;
+	}
+
+	// Write any part of a comment block that was not terminated
+	write_comment_block_to_file();
+
+	// Lookahead points that don't fit the final arc are processed again, and may form another one.  The segment
+	// optimizer has no shape until the window is planned.
+	while ((current_arc_.is_shape() || current_arc_.get_use_segment_optimizer()) && waiting_for_arc_)
 	{
 		p_logger_->log(logger_type_, DEBUG, "The target file opened successfully.");
 		process_gcode(cmd, true, false);
 	}
 	p_logger_->log(logger_type_, DEBUG, "Writing all unwritten gcodes to the target file.");
 	write_unwritten_gcodes_to_file();
+	write_shapes_();
 	p_logger_->log(logger_type_, DEBUG, "Fetching the final progress struct.");
 
-	arc_welder_progress final_progress = get_progress_(static_cast<long>(file_size_), static_cast<double>(start_clock));
+	allocation_stage_scope progress_scope(allocation_stage_progress);
+	arc_welder_progress final_progress = get_progress_(file_size_, static_cast<double>(start_clock));
 	if (progress_callback_ != NULL || info_logging_enabled_)
 	{
 		// Sending final progress update message
@@ -286,6 +457,31 @@ arc_welder_results results;
 	results.success = continue_processing;
 	results.cancelled = !continue_processing;
 	results.progress = final_progress;
+	if (info_logging_enabled_)
+	{
+		stream.clear();
+		stream.str("");
+		stream << std::fixed << std::setprecision(2) << "Arc fitting - " << final_progress.fit_validations << " validations";
+		if (final_progress.arcs_created > 0)
+		{
+			stream << " (" << static_cast<double>(final_progress.fit_validations) / final_progress.arcs_created << " per arc)";
+		}
+		stream << " in " << std::setprecision(3) << final_progress.fit_seconds << " seconds";
+		if (final_progress.arcs_created > 0)
+		{
+			stream << " (" << std::setprecision(2) << final_progress.fit_seconds * 1000000.0 / final_progress.arcs_created << " microseconds per arc)";
+		}
+		p_logger_->log(logger_type_, INFO, stream.str());
+	}
+	if (allocation_counter::is_enabled())
+	{
+		results.allocations = allocation_counter::get_counts();
+		results.steady_state_allocations = steady_state_allocations;
+		stream.clear();
+		stream.str("");
+		stream << "Allocations - " << results.allocations.str() << "\nSteady state allocations after " << ALLOCATION_WARM_UP_LINES << " lines - " << results.steady_state_allocations.str();
+		p_logger_->log(logger_type_, INFO, stream.str());
+	}
 	p_logger_->log(logger_type_, DEBUG, "Returning processing results.");
 
 	return results;
@@ -305,25 +501,41 @@ bool arc_welder::on_progress_(const arc_welder_progress& progress)
 	return true;
 }
 
-arc_welder_progress arc_welder::get_progress_(long source_file_position, double start_clock)
+arc_welder_progress arc_welder::get_progress_(long long source_file_position, double start_clock)
 {
 	arc_welder_progress progress;
 	progress.gcodes_processed = gcodes_processed_;
 	progress.lines_processed = lines_processed_;
 	progress.points_compressed = points_compressed_;
 	progress.arcs_created = arcs_created_;
+	const shape_statistic& line_statistic = shape_statistics_.shapes[SHAPE_TYPE_LINE];
+	progress.lines_simplified = line_statistic.runs_replaced;
+	progress.line_points_compressed = line_statistic.lines_replaced - line_statistic.runs_replaced;
+	progress.redundant_moves_removed = redundant_moves_removed_;
+	progress.redundant_feedrates_removed = redundant_feedrates_removed_;
+	progress.redundant_axes_removed = redundant_axes_removed_;
+	progress.redundant_fan_commands_removed = redundant_fan_commands_removed_;
+	progress.redundant_g92_commands_removed = redundant_g92_commands_removed_;
+	progress.r_arcs_written = r_arcs_written_;
+	progress.r_arc_bytes_saved = r_arc_bytes_saved_;
+	const shape_statistic& curve_statistic = shape_statistics_.shapes[SHAPE_TYPE_CURVE];
+	progress.curves_created = curve_statistic.runs_replaced;
+	progress.curve_points_compressed = curve_statistic.lines_replaced - curve_statistic.runs_replaced;
+	progress.shape_statistics = shape_statistics_;
+	progress.fit_validations = current_arc_.get_num_validations() + current_shape_arc_.get_num_validations();
+	progress.fit_seconds = fit_seconds_;
 	progress.source_file_position = source_file_position;
-	progress.target_file_size = static_cast<long>(output_file_.tellp());
+	progress.target_file_size = static_cast<long long>(output_file_.tellp());
 	progress.source_file_size = file_size_;
-	long bytesRemaining = file_size_ - static_cast<long>(source_file_position);
+	long long bytesRemaining = file_size_ - source_file_position;
 	progress.percent_complete = static_cast<double>(source_file_position) / static_cast<double>(file_size_) * 100.0;
 	progress.seconds_elapsed = get_time_elapsed(start_clock, clock());
 	double bytesPerSecond = static_cast<double>(source_file_position) / progress.seconds_elapsed;
-	progress.seconds_remaining = bytesRemaining / bytesPerSecond;
+	progress.seconds_remaining = static_cast<double>(bytesRemaining) / bytesPerSecond;
 
 	if (source_file_position > 0) {
-		progress.compression_ratio = (static_cast<float>(source_file_position) / static_cast<float>(progress.target_file_size));
-		progress.compression_percent = (1.0 - (static_cast<float>(progress.target_file_size) / static_cast<float>(source_file_position))) * 100.0f;
+		progress.compression_ratio = (static_cast<double>(source_file_position) / static_cast<double>(progress.target_file_size));
+		progress.compression_percent = (1.0 - (static_cast<double>(progress.target_file_size) / static_cast<double>(source_file_position))) * 100.0;
 	}
 
 	progress.segment_statistics = segment_statistics_;
@@ -331,15 +543,28 @@ arc_welder_progress arc_welder::get_progress_(long source_file_position, double
 	
 }
 
-int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess)
+int arc_welder::process_gcode(parsed_command& cmd, bool is_end, bool is_reprocess)
 {
-	// Update the position for the source gcode file
-	p_source_position_->update(cmd, lines_processed_, gcodes_processed_, -1);
+	// Update the position for the source gcode file.  A reprocessed command has already been applied, and there is
+	// no command to apply at the end of the file.
+	if (!is_reprocess && !is_end)
+	{
+		allocation_stage_scope position_scope(allocation_stage_position);
+		p_source_position_->update(cmd, lines_processed_, gcodes_processed_, -1);
+	}
 	position* p_cur_pos = p_source_position_->get_current_position_ptr();
 	position* p_pre_pos = p_source_position_->get_previous_position_ptr();
 	extruder extruder_current = p_cur_pos->get_current_extruder();
 	extruder previous_extruder = p_pre_pos->get_current_extruder();
 	point p(p_cur_pos->get_gcode_x(), p_cur_pos->get_gcode_y(), p_cur_pos->get_gcode_z(), extruder_current.e_relative);
+	if (p_cur_pos->is_arc)
+	{
+		// Existing arcs can be merged with the moves around them if they lie on the same circle
+		p.arc_length = p_cur_pos->get_xy_move_length(*p_pre_pos);
+		p.arc_center_x = p_pre_pos->get_gcode_x() + p_cur_pos->arc_i;
+		p.arc_center_y = p_pre_pos->get_gcode_y() + p_cur_pos->arc_j;
+		p.is_clockwise = p_cur_pos->is_clockwise;
+	}
 	//std::cout << lines_processed_ << " - " << cmd.gcode << ", CurrentEAbsolute: " << cur_extruder.e <<", ExtrusionLength: " << cur_extruder.extrusion_length << ", Retraction Length: " << cur_extruder.retraction_length << ", IsExtruding: " << cur_extruder.is_extruding << ", IsRetracting: " << cur_extruder.is_retracting << ".\n";
 
 	int lines_written = 0;
@@ -351,30 +576,28 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 	// Update the source file statistics
 	if (p_cur_pos->has_xy_position_changed && (extruder_current.is_extruding || extruder_current.is_retracting) && !is_reprocess)
 	{
-		double movement_length_mm = utilities::get_cartesian_distance(p_pre_pos->x, p_pre_pos->y, p_cur_pos->x, p_cur_pos->y);
+		double movement_length_mm = p_cur_pos->get_xy_move_length(*p_pre_pos);
 		if (movement_length_mm > 0)
 		{
 			segment_statistics_.update(movement_length_mm, true);
 		}
 	}
 
-	// We need to make sure the printer is using absolute xyz, is extruding, and the extruder axis mode is the same as that of the previous position
-	// TODO: Handle relative XYZ axis.  This is possible, but maybe not so important.
+	// We need to make sure the printer is extruding (or travelling, if allowed), and the xyz and extruder axis modes are the same as those of the previous position.
+	// Points are always absolute, relative arcs are only written as relative.  Extrusions that the shapes compete for
+	// are welded into arcs there.
 	if (
 		!is_end && cmd.is_known_command && !cmd.is_empty && (
-			(cmd.command == "G0" || cmd.command == "G1") &&
-			utilities::is_equal(p_cur_pos->z, p_pre_pos->z) &&
-			utilities::is_equal(p_cur_pos->x_offset, p_pre_pos->x_offset) &&
-			utilities::is_equal(p_cur_pos->y_offset, p_pre_pos->y_offset) &&
-			utilities::is_equal(p_cur_pos->z_offset, p_pre_pos->z_offset) &&
-			utilities::is_equal(p_cur_pos->x_firmware_offset, p_pre_pos->x_firmware_offset) &&
-			utilities::is_equal(p_cur_pos->y_firmware_offset, p_pre_pos->y_firmware_offset) &&
-			utilities::is_equal(p_cur_pos->z_firmware_offset, p_pre_pos->z_firmware_offset) &&
-			!p_cur_pos->is_relative &&
+			(cmd.command == "G0" || cmd.command == "G1" || p_cur_pos->is_arc) &&
+			!(is_arc_competing_ && is_line_point_(cmd, p_cur_pos, p_pre_pos)) &&
+			has_only_motion_parameters(cmd) &&
+			(current_arc_.get_allow_helical_arcs() ? has_same_offsets(p_cur_pos, p_pre_pos) : has_same_z_and_offsets(p_cur_pos, p_pre_pos)) &&
+			p_cur_pos->is_relative == p_pre_pos->is_relative &&
 			(
 				!waiting_for_arc_ ||
 				(previous_extruder.is_extruding && extruder_current.is_extruding) ||
-				(previous_extruder.is_retracting && extruder_current.is_retracting)
+				(previous_extruder.is_retracting && extruder_current.is_retracting) ||
+				is_travel_point_allowed(cmd, previous_extruder, extruder_current)
 			) &&
 			p_cur_pos->is_extruder_relative == p_pre_pos->is_extruder_relative &&
 			(!waiting_for_arc_ || p_pre_pos->f == p_cur_pos->f) &&
@@ -385,6 +608,7 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 		if (!waiting_for_arc_)
 		{
 			previous_is_extruder_relative_ = p_pre_pos->is_extruder_relative;
+			is_g0_arc_ = cmd.command == "G0";
 			if (debug_logging_enabled_)
 			{
 				p_logger_->log(logger_type_, DEBUG, "Starting new arc from Gcode:" + cmd.gcode);
@@ -394,12 +618,16 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 			point previous_p(p_pre_pos->get_gcode_x(), p_pre_pos->get_gcode_y(), p_pre_pos->get_gcode_z(), previous_extruder.e_relative);
 			// Don't add any extrusion, or you will over extrude!
 			//std::cout << "Trying to add first point (" << p.x << "," << p.y << "," << p.z << ")...";
+			fit_timer_scope fit_timer(fit_seconds_);
 			current_arc_.try_add_point(previous_p, 0);
 		}
 		
 		double e_relative = extruder_current.e_relative;
 		int num_points = current_arc_.get_num_segments();
-		arc_added = current_arc_.try_add_point(p, e_relative);
+		{
+			fit_timer_scope fit_timer(fit_seconds_);
+			arc_added = current_arc_.try_add_point(p, e_relative);
+		}
 		if (arc_added)
 		{
 			if (!waiting_for_arc_)
@@ -433,22 +661,31 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 			{
 				p_logger_->log(logger_type_, DEBUG, "Command '" + cmd.command + "' is Unknown.  Gcode:" + cmd.gcode);
 			}
-			else if (cmd.command != "G0" && cmd.command != "G1")
+			else if (cmd.command != "G0" && cmd.command != "G1" && !p_cur_pos->is_arc)
+			{
+				p_logger_->log(logger_type_, DEBUG, "Command '"+ cmd.command + "' is not G0/G1/G2/G3, skipping.  Gcode:" + cmd.gcode);
+			}
+			else if (!has_only_motion_parameters(cmd))
 			{
-				p_logger_->log(logger_type_, DEBUG, "Command '"+ cmd.command + "' is not G0/G1, skipping.  Gcode:" + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "Command has parameters other than X, Y, Z, E and F, skipping.  Gcode:" + cmd.gcode);
 			}
-			else if (!utilities::is_equal(p_cur_pos->z, p_pre_pos->z))
+			else if (is_arc_competing_ && is_line_point_(cmd, p_cur_pos, p_pre_pos))
+			{
+				p_logger_->log(logger_type_, DEBUG, "The shapes compete for this extrusion.  Gcode:" + cmd.gcode);
+			}
+			else if (!current_arc_.get_allow_helical_arcs() && !utilities::is_equal(p_cur_pos->z, p_pre_pos->z))
 			{
 				p_logger_->log(logger_type_, DEBUG, "Z axis position changed, cannot convert:" + cmd.gcode);
 			}
-			else if (p_cur_pos->is_relative)
+			else if (p_cur_pos->is_relative != p_pre_pos->is_relative)
 			{
-				p_logger_->log(logger_type_, DEBUG, "XYZ Axis is in relative mode, cannot convert:" + cmd.gcode);
+				p_logger_->log(logger_type_, DEBUG, "XYZ axis mode changed, cannot convert:" + cmd.gcode);
 			}
 			else if (
 				waiting_for_arc_ && !( 
 					(previous_extruder.is_extruding && extruder_current.is_extruding) ||
-					(previous_extruder.is_retracting && extruder_current.is_retracting)
+					(previous_extruder.is_retracting && extruder_current.is_retracting) ||
+					is_travel_point_allowed(cmd, previous_extruder, extruder_current)
 				)
 			)
 			{
@@ -518,68 +755,42 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 		}
 		else if (waiting_for_arc_)
 		{
+			if (current_arc_.get_use_segment_optimizer())
+			{
+				// The run of moves has ended, or the window is full
+				process_window_(cmd, is_end);
+				return 0;
+			}
 
 			if (current_arc_.is_shape())
 			{
-				// update our statistics
-				points_compressed_ += current_arc_.get_num_segments()-1;
-				arcs_created_++; // increment the number of generated arcs
-
-				//std::cout << "Arc shape found.\n";
-				// Get the comment now, before we remove the previous comments
-				std::string comment = get_comment_for_arc();
-				// remove the same number of unwritten gcodes as there are arc segments, minus 1 for the start point
-				// Which isn't a movement
-				// note, skip the first point, it is the starting point
-				for (int index = 0; index < current_arc_.get_num_segments() - 1; index++)
+				// Check the lookahead points that are still waiting.  The ones that don't fit come after the arc, as
+				// does the current command, so they are set aside and processed again once the arc is written.
+				int num_rejected;
 				{
-					unwritten_commands_.pop_back();
-				}
-				// get the feedrate for the previous position (the last command that was turned into an arc)
-				double current_f = p_pre_pos->f;
-				
-				// Undo the current command, since it isn't included in the arc
-				p_source_position_->undo_update();
-				// IMPORTANT NOTE: p_cur_pos and p_pre_pos will NOT be usable beyond this point.
-				p_pre_pos = NULL;
-				p_cur_pos = p_source_position_->get_current_position_ptr();
-				extruder_current = p_cur_pos->get_current_extruder();
-
-				// Set the current feedrate if it is different, else set to 0 to indicate that no feedrate should be included
-				if(previous_feedrate_ > 0 && previous_feedrate_ == current_f){
-					current_f = 0;
-				}
-
-				// Craete the arc gcode
-				std::string gcode;
-				if (previous_is_extruder_relative_){
-					gcode = get_arc_gcode_relative(current_f, comment);
+					fit_timer_scope fit_timer(fit_seconds_);
+					num_rejected = current_arc_.resolve_lookahead();
 				}
-					
-				else { 
-					gcode = get_arc_gcode_absolute(extruder_current.get_offset_e(), current_f, comment);
+				int num_to_reprocess = num_rejected;
+				if (!is_end)
+				{
+					commands_to_reprocess_.push_front() = cmd;
+					num_to_reprocess++;
 				}
-				
-
-				if (debug_logging_enabled_)
+				for (int index = 0; index < num_rejected; index++)
 				{
-				  char buffer[20];
-					std::string message = "Arc created with ";
-					sprintf(buffer, "%d", current_arc_.get_num_segments());
-					message += buffer;
-					message += " segments: ";
-					message += gcode;
-					p_logger_->log(logger_type_, DEBUG, message);
+					commands_to_reprocess_.push_front() = unwritten_commands_.pop_back().command;
 				}
 
-				// Get and alter the current position so we can add it to the unwritten commands list
-				parsed_command arc_command = parser_.parse_gcode(gcode.c_str());
-				double arc_extrusion_length = current_arc_.get_shape_length();
-				
-				unwritten_commands_.push_back(
-					unwritten_command(arc_command, p_cur_pos->is_extruder_relative, arc_extrusion_length)
-				);
-				
+				// Step back to the end of the arc, since the commands set aside above aren't included in it.  These
+				// are restored with redo_update when they are reprocessed.
+				p_source_position_->undo_update(num_to_reprocess);
+				// IMPORTANT NOTE: p_cur_pos and p_pre_pos will NOT be usable beyond this point.
+				p_pre_pos = NULL;
+				p_cur_pos = p_source_position_->get_current_position_ptr();
+				// Every point after the first is one of the most recent positions
+				add_arc_to_unwritten_commands_(p_source_position_->get_position_ptr(current_arc_.get_num_segments() - 1), p_cur_pos);
+
 				// write all unwritten commands (if we don't do this we'll mess up absolute e by adding an offset to the arc)
 				// including the most recent arc command BEFORE updating the absolute e offset
 				write_unwritten_gcodes_to_file();
@@ -589,20 +800,13 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 				current_arc_.clear();
 				
 
-				// Reprocess this line
-				if (!is_end)
+				if (is_end && debug_logging_enabled_)
 				{
-					return process_gcode(cmd, false, true);
+					p_logger_->log(logger_type_, DEBUG, "Final arc created, exiting.");
 				}
-				else
-				{
-					if (debug_logging_enabled_)
-					{
-						p_logger_->log(logger_type_, DEBUG, "Final arc created, exiting.");
-					}
-					return 0;
-				}
-					
+				// Restore the positions of the commands that were set aside and reprocess them
+				reprocess_commands_();
+				return 0;
 			}
 			else
 			{
@@ -627,14 +831,34 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 		position* cur_pos = p_source_position_->get_current_position_ptr();
 		extruder& cur_extruder = cur_pos->get_current_extruder();
 
+		position* prev_pos = p_source_position_->get_previous_position_ptr();
+
 		double length = 0;
+		const position* p_line_start_pos = NULL;
 		if (p_cur_pos->has_xy_position_changed && (cur_extruder.is_extruding || cur_extruder.is_retracting))
 		{
-			position* prev_pos = p_source_position_->get_previous_position_ptr();
-			length = utilities::get_cartesian_distance(cur_pos->x, cur_pos->y, prev_pos->x, prev_pos->y);
+			length = cur_pos->get_xy_move_length(*prev_pos);
+			if (shape_competitor_count_ > 0 && is_line_point_(cmd, cur_pos, prev_pos))
+			{
+				p_line_start_pos = prev_pos;
+			}
 		}
 		
-		unwritten_commands_.push_back(unwritten_command(cur_pos, length));
+		unwritten_command& command = unwritten_commands_.push_back();
+		command.set(cmd, cur_pos, length);
+		if (p_line_start_pos != NULL)
+		{
+			command.set_line(p_line_start_pos, cur_pos);
+		}
+		if (remove_redundant_commands_)
+		{
+			command.redundant_parameters = get_redundant_parameters_(cmd, cur_pos, prev_pos);
+			update_is_e_position_known_(cmd, cur_pos);
+		}
+		if (remove_redundant_commands_ || minify_gcode_)
+		{
+			command.absolute_parameters = get_absolute_parameters(cmd, cur_pos);
+		}
 		
 	}
 	if (!waiting_for_arc_)
@@ -644,15 +868,184 @@ int arc_welder::process_gcode(parsed_command cmd, bool is_end, bool is_reprocess
 	return lines_written;
 }
 
-std::string arc_welder::get_comment_for_arc()
+void arc_welder::reprocess_commands_()
+{
+	// Arcs closed while reprocessing add their commands to the front of the list, so only the outermost call
+	// processes it.
+	if (is_reprocessing_)
+		return;
+	is_reprocessing_ = true;
+	while (commands_to_reprocess_.count() > 0)
+	{
+		reprocess_command_ = commands_to_reprocess_.pop_front();
+		p_source_position_->redo_update();
+		process_gcode(reprocess_command_, false, true);
+	}
+	is_reprocessing_ = false;
+}
+
+void arc_welder::add_arc_to_unwritten_commands_(const position* p_start_pos, const position* p_end_pos)
+{
+	// update our statistics
+	points_compressed_ += current_arc_.get_num_segments()-1;
+	arcs_created_++; // increment the number of generated arcs
+
+	// Get the comment now, before we remove the previous comments
+	get_comment_for_arc(arc_comment_);
+	// The same goes for the exact e value of the arc
+	long long arc_e_relative_fixed = use_fixed_point_ ? get_arc_e_relative_fixed() : 0;
+	// remove the same number of unwritten gcodes as there are arc segments, minus 1 for the start point
+	// Which isn't a movement
+	// note, skip the first point, it is the starting point
+	for (int index = 0; index < current_arc_.get_num_segments() - 1; index++)
+	{
+		unwritten_commands_.pop_back();
+	}
+	const extruder& end_extruder = p_end_pos->get_current_extruder();
+	// get the feedrate for the last command that was turned into an arc
+	double current_f = p_end_pos->f;
+
+	// Set the current feedrate if it is different, else set to 0 to indicate that no feedrate should be included
+	if(previous_feedrate_ > 0 && previous_feedrate_ == current_f){
+		current_f = 0;
+	}
+
+	// Add the arc to the unwritten commands.  It is not converted to text until it is written.
+	double arc_extrusion_length = current_arc_.get_shape_length();
+	unwritten_command& arc_unwritten_command = unwritten_commands_.push_back();
+	arc_unwritten_command.set_arc(arc_comment_, p_end_pos->is_extruder_relative, arc_extrusion_length);
+
+	// Craete the arc command
+	if (use_fixed_point_)
+	{
+		// Relative arcs get the exact sum of the source e values, absolute arcs the exact e of the end point
+		long long arc_e_fixed = previous_is_extruder_relative_ ? arc_e_relative_fixed : end_extruder.get_offset_e_fixed();
+		current_arc_.get_shape_command_fixed(p_end_pos->get_gcode_x_fixed(), p_end_pos->get_gcode_y_fixed(), p_end_pos->get_gcode_z_fixed(), arc_e_relative_fixed != 0, arc_e_fixed, current_f, arc_unwritten_command.arc);
+	}
+	else if (previous_is_extruder_relative_){
+		current_arc_.get_shape_command_relative(current_f, arc_unwritten_command.arc);
+	}
+		
+	else { 
+		current_arc_.get_shape_command_absolute(end_extruder.get_offset_e(), current_f, arc_unwritten_command.arc);
+	}
+
+	if (p_end_pos->is_relative)
+	{
+		// In relative (G91) mode the end point is the distance moved, which is exact in fixed point
+		arc_command& arc = arc_unwritten_command.arc;
+		arc.is_relative = true;
+		arc.x_fixed = p_end_pos->get_gcode_x_fixed() - p_start_pos->get_gcode_x_fixed();
+		arc.y_fixed = p_end_pos->get_gcode_y_fixed() - p_start_pos->get_gcode_y_fixed();
+		arc.z_fixed = p_end_pos->get_gcode_z_fixed() - p_start_pos->get_gcode_z_fixed();
+	}
+
+	if (debug_logging_enabled_)
+	{
+		char buffer[20];
+		std::string message = "Arc created with ";
+		sprintf(buffer, "%d", current_arc_.get_num_segments());
+		message += buffer;
+		message += " segments: ";
+		message += arc_unwritten_command.to_string(false, "");
+		p_logger_->log(logger_type_, DEBUG, message);
+	}
+}
+
+void arc_welder::process_window_(parsed_command& cmd, bool is_end)
+{
+	// The window is the start point of the run plus one point for each unwritten command.  Move the commands aside and
+	// add them back in order, replacing the planned arcs as they are reached.
+	int num_commands = unwritten_commands_.count();
+	bool is_window_full = current_arc_.get_num_segments() >= current_arc_.get_max_segments();
+	window_commands_.clear();
+	for (int index = 0; index < num_commands; index++)
+	{
+		window_commands_.push_back() = unwritten_commands_.pop_front();
+	}
+	{
+		fit_timer_scope fit_timer(fit_seconds_);
+		current_arc_.plan_window();
+	}
+	// If the window is full the run continues, so the segment ending at the last point may be extended by the next
+	// window.  Leave it for the next window, unless it is the whole window.
+	int num_committed = num_commands;
+	if (is_window_full)
+	{
+		for (int index = 0; index < num_commands; index++)
+		{
+			int end_index = current_arc_.get_planned_arc_end(index);
+			if (index > 0 && (end_index == num_commands || (end_index == -1 && index == num_commands - 1)))
+			{
+				num_committed = index;
+				break;
+			}
+			if (end_index != -1)
+			{
+				index = end_index - 1;
+			}
+		}
+	}
+
+	// The current position is the command that ended the run, unless this is the end of the file.  The position of
+	// point index is the position of command index - 1.
+	int last_point_offset = is_end ? 0 : 1;
+	int start_index = 0;
+	while (start_index < num_committed)
+	{
+		int end_index = current_arc_.get_planned_arc_end(start_index);
+		for (int index = start_index; index < (end_index == -1 ? start_index + 1 : end_index); index++)
+		{
+			unwritten_commands_.push_back() = window_commands_[index];
+		}
+		if (end_index == -1)
+		{
+			start_index++;
+			continue;
+		}
+		bool arc_loaded;
+		{
+			fit_timer_scope fit_timer(fit_seconds_);
+			arc_loaded = current_arc_.load_planned_arc(start_index, end_index);
+		}
+		if (arc_loaded)
+		{
+			const position* p_start_pos = p_source_position_->get_position_ptr(num_commands - start_index + last_point_offset);
+			previous_feedrate_ = p_start_pos->f;
+			previous_is_extruder_relative_ = p_start_pos->is_extruder_relative;
+			add_arc_to_unwritten_commands_(p_start_pos, p_source_position_->get_position_ptr(num_commands - end_index + last_point_offset));
+		}
+		current_arc_.clear();
+		start_index = end_index;
+	}
+	write_unwritten_gcodes_to_file();
+	waiting_for_arc_ = false;
+	current_arc_.clear();
+
+	// Reprocess the commands that were not committed, and the current command, which may start the next run
+	int num_to_reprocess = num_commands - num_committed;
+	if (!is_end)
+	{
+		commands_to_reprocess_.push_front() = cmd;
+		num_to_reprocess++;
+	}
+	for (int index = num_commands - 1; index >= num_committed; index--)
+	{
+		commands_to_reprocess_.push_front() = window_commands_[index].command;
+	}
+	p_source_position_->undo_update(num_to_reprocess);
+	reprocess_commands_();
+}
+
+void arc_welder::get_comment_for_arc(std::string& comment)
 {
 	// build a comment string from the commands making up the arc
 				// We need to start with the first command entered.
 	int comment_index = unwritten_commands_.count() - (current_arc_.get_num_segments() - 1);
-	std::string comment;
+	comment.clear();
 	for (; comment_index < unwritten_commands_.count(); comment_index++)
 	{
-		std::string old_comment = unwritten_commands_[comment_index].command.comment;
+		const std::string& old_comment = unwritten_commands_[comment_index].command.comment;
 		if (old_comment != comment && old_comment.length() > 0)
 		{
 			if (comment.length() > 0)
@@ -662,7 +1055,103 @@ std::string arc_welder::get_comment_for_arc()
 			comment += old_comment;
 		}
 	}
-	return comment;
+}
+
+long long arc_welder::get_arc_e_relative_fixed()
+{
+	// The arc segments are the most recent unwritten commands, not counting the start point
+	long long e_relative_fixed = 0;
+	int index = unwritten_commands_.count() - (current_arc_.get_num_segments() - 1);
+	for (; index < unwritten_commands_.count(); index++)
+	{
+		e_relative_fixed += unwritten_commands_[index].e_relative_fixed;
+	}
+	return e_relative_fixed;
+}
+
+bool arc_welder::has_same_z_and_offsets(const position* p_cur_pos, const position* p_pre_pos) const
+{
+	if (use_fixed_point_)
+	{
+		return p_cur_pos->z_fixed == p_pre_pos->z_fixed && has_same_offsets(p_cur_pos, p_pre_pos);
+	}
+	return utilities::is_equal(p_cur_pos->z, p_pre_pos->z) && has_same_offsets(p_cur_pos, p_pre_pos);
+}
+
+bool arc_welder::has_same_offsets(const position* p_cur_pos, const position* p_pre_pos) const
+{
+	if (use_fixed_point_)
+	{
+		return (
+			p_cur_pos->x_offset_fixed == p_pre_pos->x_offset_fixed &&
+			p_cur_pos->y_offset_fixed == p_pre_pos->y_offset_fixed &&
+			p_cur_pos->z_offset_fixed == p_pre_pos->z_offset_fixed &&
+			p_cur_pos->x_firmware_offset_fixed == p_pre_pos->x_firmware_offset_fixed &&
+			p_cur_pos->y_firmware_offset_fixed == p_pre_pos->y_firmware_offset_fixed &&
+			p_cur_pos->z_firmware_offset_fixed == p_pre_pos->z_firmware_offset_fixed
+		);
+	}
+	return (
+		utilities::is_equal(p_cur_pos->x_offset, p_pre_pos->x_offset) &&
+		utilities::is_equal(p_cur_pos->y_offset, p_pre_pos->y_offset) &&
+		utilities::is_equal(p_cur_pos->z_offset, p_pre_pos->z_offset) &&
+		utilities::is_equal(p_cur_pos->x_firmware_offset, p_pre_pos->x_firmware_offset) &&
+		utilities::is_equal(p_cur_pos->y_firmware_offset, p_pre_pos->y_firmware_offset) &&
+		utilities::is_equal(p_cur_pos->z_firmware_offset, p_pre_pos->z_firmware_offset)
+	);
+}
+
+// A travel point neither extrudes nor retracts, and neither does the point before it.  G0 points are only welded when
+// G0 travel arcs are allowed, and an arc never mixes G0 and G1 moves.
+bool arc_welder::is_travel_point_allowed(const parsed_command& cmd, const extruder& previous_extruder, const extruder& extruder_current) const
+{
+	if (
+		!allow_travel_arcs_ ||
+		previous_extruder.is_extruding || previous_extruder.is_retracting ||
+		extruder_current.is_extruding || extruder_current.is_retracting
+	)
+	{
+		return false;
+	}
+	if (cmd.command == "G0")
+	{
+		return allow_g0_travel_arcs_ && is_g0_arc_;
+	}
+	return !is_g0_arc_;
+}
+
+// Any other parameter (laser power, for example) would be lost when the command is replaced by an arc.  Existing
+// arcs also have their center, as I and J or R.  Values too large for fixed point can't be rewritten exactly, so those
+// commands are left as they are.
+bool arc_welder::has_only_motion_parameters(const parsed_command& cmd)
+{
+	for (std::vector<parsed_command_parameter>::const_iterator it = cmd.parameters.begin(); it != cmd.parameters.end(); ++it)
+	{
+		if (it->name.length() != 1 || (it->value_type == 'F' && !it->has_fixed_value))
+		{
+			return false;
+		}
+		switch (it->name[0])
+		{
+		case 'X':
+		case 'Y':
+		case 'Z':
+		case 'E':
+		case 'F':
+			break;
+		case 'I':
+		case 'J':
+		case 'R':
+			if (cmd.command != "G2" && cmd.command != "G3")
+			{
+				return false;
+			}
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
 }
 
 std::string arc_welder::create_g92_e(double absolute_e)
@@ -673,60 +1162,710 @@ std::string arc_welder::create_g92_e(double absolute_e)
 	return stream.str();
 }
 
-int arc_welder::write_gcode_to_file(std::string gcode)
+int arc_welder::write_gcode_to_file(const std::string& gcode, const std::string& comment)
 {
-	output_file_ << gcode << "\n";
+	// Same output as parsed_command::to_string, without building the string
+	output_file_.write(gcode.c_str(), gcode.length());
+	if (comment.length() > 0)
+	{
+		output_file_.put(';');
+		output_file_.write(comment.c_str(), comment.length());
+	}
+	output_file_.put('\n');
 	return 1;
 }
 
+int arc_welder::write_gcode_to_file(const unwritten_command& command)
+{
+	if (command.is_arc)
+	{
+		if (remove_redundant_commands_)
+		{
+			unreliable_parameters_ = PARAMETER_X | PARAMETER_Y | PARAMETER_Z | PARAMETER_E | PARAMETER_F;
+		}
+		// This is the only place generated arcs are converted to text
+		if (minify_gcode_)
+		{
+			command.arc.to_minified_string(arc_gcode_, minify_max_error_fixed_, !minify_gcode_remove_spaces_);
+		}
+		else
+		{
+			command.arc.to_string(arc_gcode_);
+		}
+		if (
+			allow_r_arcs_ &&
+			command.arc.to_r_string(r_arc_gcode_, r_arc_max_path_error_, r_arc_start_error_, minify_gcode_, minify_max_error_fixed_, !minify_gcode_remove_spaces_) &&
+			r_arc_gcode_.length() < arc_gcode_.length()
+		)
+		{
+			r_arcs_written_++;
+			r_arc_bytes_saved_ += arc_gcode_.length() - r_arc_gcode_.length();
+			return write_gcode_to_file(r_arc_gcode_, command.command.comment);
+		}
+		return write_gcode_to_file(arc_gcode_, command.command.comment);
+	}
+	if (remove_redundant_commands_)
+	{
+		// Only commands that are written are counted, since the others were replaced by arcs or lines.
+		int redundant_parameters = command.redundant_parameters;
+		if (redundant_parameters & unreliable_parameters_)
+		{
+			redundant_parameters &= ~(unreliable_parameters_ | REDUNDANT_COMMAND);
+		}
+		unreliable_parameters_ &= ~command.absolute_parameters;
+		if (is_redundant_fan_command_(command.command))
+		{
+			redundant_fan_commands_removed_++;
+			redundant_parameters = REDUNDANT_COMMAND;
+		}
+		if (redundant_parameters & REDUNDANT_COMMAND)
+		{
+			if (command.command.command == "G92")
+			{
+				redundant_g92_commands_removed_++;
+			}
+			else if (command.command.command == "G0" || command.command.command == "G1")
+			{
+				redundant_moves_removed_++;
+			}
+			// Keep the comment
+			if (command.command.comment.length() == 0)
+			{
+				return 0;
+			}
+			trimmed_gcode_.clear();
+			return write_gcode_to_file(trimmed_gcode_, command.command.comment);
+		}
+		if (redundant_parameters != PARAMETER_NONE)
+		{
+			get_trimmed_gcode_(command.command, redundant_parameters, command.absolute_parameters, trimmed_gcode_);
+			return write_gcode_to_file(trimmed_gcode_, command.command.comment);
+		}
+	}
+	if (minify_gcode_ && can_minify(command.command))
+	{
+		get_trimmed_gcode_(command.command, PARAMETER_NONE, command.absolute_parameters, trimmed_gcode_);
+		return write_gcode_to_file(trimmed_gcode_, command.command.comment);
+	}
+	return write_gcode_to_file(command.command.gcode, command.command.comment);
+}
+
+// A move that changes nothing is redundant, as are the parameters of a move that are already set.  Only moves with
+// numeric X, Y, Z, E and F parameters are checked, so that nothing else can be lost.  A G92 that only sets E is
+// redundant if E is already at that value.  Whole commands also get the flags of their redundant parameters, since
+// they must be written if one of those was not written exactly (see unreliable_parameters_).
+int arc_welder::get_redundant_parameters_(const parsed_command& cmd, const position* p_cur_pos, const position* p_pre_pos) const
+{
+	if (cmd.command == "G92")
+	{
+		if (
+			is_e_position_known_ &&
+			cmd.parameters.size() == 1 && cmd.parameters[0].name == "E" && cmd.parameters[0].value_type == 'F' &&
+			cmd.parameters[0].has_fixed_value && cmd.parameters[0].fixed_value == p_pre_pos->get_current_extruder().get_offset_e_fixed()
+		)
+		{
+			return PARAMETER_E | REDUNDANT_COMMAND;
+		}
+		return PARAMETER_NONE;
+	}
+	if ((cmd.command != "G0" && cmd.command != "G1") || !has_only_motion_parameters(cmd))
+	{
+		return PARAMETER_NONE;
+	}
+
+	int redundant_parameters = PARAMETER_NONE;
+	unsigned int num_redundant = 0;
+	for (std::vector<parsed_command_parameter>::const_iterator it = cmd.parameters.begin(); it != cmd.parameters.end(); ++it)
+	{
+		if (it->value_type != 'F')
+		{
+			return PARAMETER_NONE;
+		}
+		long long value = it->fixed_value;
+		int flag = get_parameter_flag(it->name);
+		bool is_redundant = false;
+		switch (flag)
+		{
+		case PARAMETER_X:
+			is_redundant = p_cur_pos->is_relative ? value == 0 : !p_pre_pos->x_null && value == p_pre_pos->get_gcode_x_fixed();
+			break;
+		case PARAMETER_Y:
+			is_redundant = p_cur_pos->is_relative ? value == 0 : !p_pre_pos->y_null && value == p_pre_pos->get_gcode_y_fixed();
+			break;
+		case PARAMETER_Z:
+			is_redundant = p_cur_pos->is_relative ? value == 0 : !p_pre_pos->z_null && value == p_pre_pos->get_gcode_z_fixed();
+			break;
+		case PARAMETER_E:
+			is_redundant = (
+				!p_cur_pos->is_extruder_relative_null &&
+				(p_cur_pos->is_extruder_relative ? value == 0 : is_e_position_known_ && value == p_pre_pos->get_current_extruder().get_offset_e_fixed())
+			);
+			break;
+		case PARAMETER_F:
+			is_redundant = p_pre_pos->f > 0 && it->double_value == p_pre_pos->f;
+			break;
+		}
+		if (is_redundant)
+		{
+			redundant_parameters |= flag;
+			num_redundant++;
+		}
+	}
+	// A move without any parameters that change something does nothing
+	if (num_redundant == cmd.parameters.size())
+	{
+		redundant_parameters |= REDUNDANT_COMMAND;
+	}
+	return redundant_parameters;
+}
+
+// The parameters that set the position or feedrate to a value, rather than changing it by a distance
+int arc_welder::get_absolute_parameters(const parsed_command& cmd, const position* p_cur_pos)
+{
+	bool is_g92 = cmd.command == "G92";
+	if (!is_g92 && cmd.command != "G0" && cmd.command != "G1" && cmd.command != "G2" && cmd.command != "G3")
+	{
+		return PARAMETER_NONE;
+	}
+	int absolute_parameters = PARAMETER_NONE;
+	for (std::vector<parsed_command_parameter>::const_iterator it = cmd.parameters.begin(); it != cmd.parameters.end(); ++it)
+	{
+		int flag = get_parameter_flag(it->name);
+		if (
+			is_g92 || flag == PARAMETER_F ||
+			(flag == PARAMETER_E && !p_cur_pos->is_extruder_relative) ||
+			(flag != PARAMETER_E && !p_cur_pos->is_relative)
+		)
+		{
+			absolute_parameters |= flag;
+		}
+	}
+	return absolute_parameters;
+}
+
+int arc_welder::get_parameter_flag(const std::string& name)
+{
+	if (name.length() != 1)
+	{
+		return PARAMETER_NONE;
+	}
+	switch (name[0])
+	{
+	case 'X':
+		return PARAMETER_X;
+	case 'Y':
+		return PARAMETER_Y;
+	case 'Z':
+		return PARAMETER_Z;
+	case 'E':
+		return PARAMETER_E;
+	case 'F':
+		return PARAMETER_F;
+	}
+	return PARAMETER_NONE;
+}
+
+void arc_welder::update_is_e_position_known_(const parsed_command& cmd, const position* p_cur_pos)
+{
+	if (cmd.command.length() > 0 && cmd.command[0] == 'T')
+	{
+		is_e_position_known_ = false;
+		return;
+	}
+	if (
+		cmd.command != "G92" &&
+		(p_cur_pos->is_extruder_relative || (cmd.command != "G0" && cmd.command != "G1" && cmd.command != "G2" && cmd.command != "G3"))
+	)
+	{
+		return;
+	}
+	for (std::vector<parsed_command_parameter>::const_iterator it = cmd.parameters.begin(); it != cmd.parameters.end(); ++it)
+	{
+		if (it->name == "E" && it->value_type == 'F')
+		{
+			is_e_position_known_ = true;
+			return;
+		}
+	}
+}
+
+// M106 and M107 commands that repeat the last one are redundant.  A tool change may change which fan they control, so
+// it is always followed by the next fan command.
+bool arc_welder::is_redundant_fan_command_(const parsed_command& cmd)
+{
+	if (cmd.command.length() > 0 && cmd.command[0] == 'T')
+	{
+		has_previous_fan_command_ = false;
+		return false;
+	}
+	if (cmd.command != "M106" && cmd.command != "M107")
+	{
+		return false;
+	}
+	if (has_previous_fan_command_ && has_same_parameters(cmd, previous_fan_command_))
+	{
+		return true;
+	}
+	previous_fan_command_ = cmd;
+	has_previous_fan_command_ = true;
+	return false;
+}
+
+bool arc_welder::has_same_parameters(const parsed_command& cmd_1, const parsed_command& cmd_2)
+{
+	if (cmd_1.command != cmd_2.command || cmd_1.parameters.size() != cmd_2.parameters.size())
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < cmd_1.parameters.size(); index++)
+	{
+		const parsed_command_parameter& parameter_1 = cmd_1.parameters[index];
+		const parsed_command_parameter& parameter_2 = cmd_2.parameters[index];
+		if (
+			parameter_1.name != parameter_2.name ||
+			parameter_1.value_type != parameter_2.value_type ||
+			parameter_1.fixed_value != parameter_2.fixed_value ||
+			parameter_1.has_fixed_value != parameter_2.has_fixed_value ||
+			(parameter_1.value_type == 'F' && !parameter_1.has_fixed_value && parameter_1.double_value != parameter_2.double_value) ||
+			parameter_1.unsigned_long_value != parameter_2.unsigned_long_value ||
+			parameter_1.string_value != parameter_2.string_value
+		)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Rebuilds the gcode without the redundant parameters.  The values are written from their exact fixed point values,
+// or minified, in which case only absolute coordinates are rounded.
+void arc_welder::get_trimmed_gcode_(const parsed_command& cmd, int redundant_parameters, int absolute_parameters, std::string& gcode)
+{
+	gcode = cmd.command;
+	for (std::vector<parsed_command_parameter>::const_iterator it = cmd.parameters.begin(); it != cmd.parameters.end(); ++it)
+	{
+		int flag = get_parameter_flag(it->name);
+		if (redundant_parameters & flag)
+		{
+			if (flag == PARAMETER_F)
+			{
+				redundant_feedrates_removed_++;
+			}
+			else
+			{
+				redundant_axes_removed_++;
+			}
+			continue;
+		}
+		append_gcode_parameter_(gcode, it->name[0], it->fixed_value, (flag & absolute_parameters & (PARAMETER_X | PARAMETER_Y | PARAMETER_Z)) != 0);
+	}
+}
+
+// Only moves with numeric X, Y, Z, E and F parameters are rewritten, so that nothing else can change.
+bool arc_welder::can_minify(const parsed_command& cmd)
+{
+	if ((cmd.command != "G0" && cmd.command != "G1") || !has_only_motion_parameters(cmd))
+	{
+		return false;
+	}
+	for (std::vector<parsed_command_parameter>::const_iterator it = cmd.parameters.begin(); it != cmd.parameters.end(); ++it)
+	{
+		if (it->value_type != 'F')
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void arc_welder::append_gcode_parameter_(std::string& gcode, char name, long long value, bool can_round)
+{
+	parameter_format_.append_parameter(gcode, name, value, can_round);
+}
+
 int arc_welder::write_unwritten_gcodes_to_file()
 {
+	allocation_stage_scope write_scope(allocation_stage_write);
 	int size = unwritten_commands_.count();
-	std::string gcode_to_write;
-	
 	
 	for (int index = 0; index < size; index++)
 	{
 		// The the current unwritten position and remove it from the list
-		unwritten_command p = unwritten_commands_.pop_front();
+		const unwritten_command& p = unwritten_commands_.pop_front();
+		if (shape_competitor_count_ > 0)
+		{
+			write_shape_command_(p);
+			continue;
+		}
 		if (p.extrusion_length > 0)
 		{
 			segment_statistics_.update(p.extrusion_length, false);
 		}
-		write_gcode_to_file(p.command.to_string());
+		write_gcode_to_file(p);
 	}
 	
 	return size;
 }
 
-std::string arc_welder::get_arc_gcode_relative(double f, const std::string comment)
+// Only G1 extrusions that stay at the same height are simplified.  Any other parameter would be lost, and in relative
+// (G91) mode the merged line would need the sum of the distances.
+bool arc_welder::is_line_point_(const parsed_command& cmd, const position* p_cur_pos, const position* p_pre_pos) const
 {
-	// Write gcode to file
-	std::string gcode;
+	return (
+		cmd.command == "G1" &&
+		has_only_motion_parameters(cmd) &&
+		!p_cur_pos->is_relative && !p_pre_pos->is_relative &&
+		p_cur_pos->is_extruder_relative == p_pre_pos->is_extruder_relative &&
+		p_cur_pos->get_current_extruder().is_extruding &&
+		has_same_z_and_offsets(p_cur_pos, p_pre_pos)
+	);
+}
 
-	gcode = current_arc_.get_shape_gcode_relative(f);
-	
-	if (comment.length() > 0)
+bool arc_welder::can_extend_line(const unwritten_command& previous, const unwritten_command& command)
+{
+	return (
+		command.start_x == previous.end_x && command.start_y == previous.end_y &&
+		command.f == previous.f &&
+		command.is_extruder_relative == previous.is_extruder_relative &&
+		command.feature_type_tag == previous.feature_type_tag
+	);
+}
+
+void arc_welder::add_shape_competitor_(shape_type type, segmented_shape* p_shape)
+{
+	shape_competitor& competitor = shape_competitors_[shape_competitor_count_++];
+	competitor.type = type;
+	competitor.p_shape = p_shape;
+	shape_statistics_.shapes[type].is_enabled = true;
+}
+
+// Holds lines while the shapes compete for them, and writes everything else after the lines before it.
+void arc_welder::write_shape_command_(const unwritten_command& command)
+{
+	if (!command.is_line)
 	{
-		gcode += ";" + comment;
+		write_shapes_();
+		if (command.extrusion_length > 0)
+		{
+			segment_statistics_.update(command.extrusion_length, false);
+		}
+		write_gcode_to_file(command);
+		return;
+	}
+	pending_shape_commands_.push_back() = command;
+	while (pending_shape_commands_.count() > 0)
+	{
+		if (try_add_to_shapes_(pending_shape_commands_[0]))
+		{
+			shape_commands_.push_back() = pending_shape_commands_[0];
+			pending_shape_commands_.pop_front();
+			continue;
+		}
+		write_best_shape_();
+	}
+}
+
+// Every shape takes lines until one doesn't fit, and then holds the lines it took.  The run goes on as long as any
+// of them is still growing.
+bool arc_welder::try_add_to_shapes_(const unwritten_command& command)
+{
+	point end_point(command.end_x, command.end_y, 0, 0);
+	if (shape_commands_.count() == 0)
+	{
+		for (int index = 0; index < shape_competitor_count_; index++)
+		{
+			shape_competitor& competitor = shape_competitors_[index];
+			competitor.p_shape->try_add_point(point(command.start_x, command.start_y, 0, 0), 0);
+			competitor.is_growing = competitor.p_shape->try_add_point(end_point, command.e_relative);
+			competitor.num_commands = competitor.is_growing ? 1 : 0;
+		}
+		return true;
+	}
+	if (!can_extend_line(shape_commands_[shape_commands_.count() - 1], command))
+	{
+		return false;
+	}
+	bool is_added = false;
+	for (int index = 0; index < shape_competitor_count_; index++)
+	{
+		shape_competitor& competitor = shape_competitors_[index];
+		if (!competitor.is_growing)
+		{
+			continue;
+		}
+		// A shape that drops points from the start of the run, as arcs do until they have min_segments points, no longer
+		// holds the run
+		if (competitor.p_shape->try_add_point(end_point, command.e_relative) && competitor.p_shape->get_num_segments() == competitor.num_commands + 2)
+		{
+			competitor.num_commands++;
+			is_added = true;
+		}
+		else
+		{
+			competitor.is_growing = false;
+		}
+	}
+	return is_added;
+}
+
+// Writes the shape that replaces the most lines from the start of the run, or that saves the most bytes if more than
+// one replaces the same lines.  If none of them do, the lines are written as they are.  The lines after the ones that
+// were written are offered to the shapes again as the start of the next run.
+void arc_welder::write_best_shape_()
+{
+	const shape_competitor* p_best = NULL;
+	long long best_bytes_saved = 0;
+	int num_shapes = 0;
+	int num_commands = 1;
+	for (int index = 0; index < shape_competitor_count_; index++)
+	{
+		const shape_competitor& competitor = shape_competitors_[index];
+		if (competitor.num_commands > num_commands)
+		{
+			num_commands = competitor.num_commands;
+		}
+		if (!competitor.p_shape->is_shape())
+		{
+			continue;
+		}
+		num_shapes++;
+		if (p_best != NULL && competitor.num_commands < p_best->num_commands)
+		{
+			continue;
+		}
+		// Count the bytes of the source lines, which is all that can be compared before they are written
+		get_shape_gcode_(competitor, shape_gcode_);
+		long long bytes_saved = -static_cast<long long>(shape_gcode_.length() + 1);
+		for (int command_index = 0; command_index < competitor.num_commands; command_index++)
+		{
+			bytes_saved += shape_commands_[command_index].command.gcode.length() + 1;
+		}
+		if (p_best == NULL || competitor.num_commands > p_best->num_commands || bytes_saved > best_bytes_saved)
+		{
+			p_best = &competitor;
+			best_bytes_saved = bytes_saved;
+		}
+	}
+
+	if (p_best == NULL)
+	{
+		for (int index = 0; index < num_commands; index++)
+		{
+			const unwritten_command& command = shape_commands_[index];
+			if (command.extrusion_length > 0)
+			{
+				segment_statistics_.update(command.extrusion_length, false);
+			}
+			write_gcode_to_file(command);
+		}
+	}
+	else
+	{
+		num_commands = p_best->num_commands;
+		double shape_length = get_shape_gcode_(*p_best, shape_gcode_);
+		get_run_comment_(num_commands, shape_comment_);
+		shape_statistic& statistic = shape_statistics_.shapes[p_best->type];
+		statistic.runs_replaced++;
+		statistic.lines_replaced += num_commands;
+		if (p_best->type == SHAPE_TYPE_ARC)
+		{
+			arcs_created_++;
+			points_compressed_ += num_commands;
+		}
+		statistic.bytes_saved += best_bytes_saved;
+		if (num_shapes > 1)
+		{
+			statistic.contested_runs_won++;
+		}
+		segment_statistics_.update(shape_length, false);
+		if (debug_logging_enabled_)
+		{
+			char count_buffer[20];
+			sprintf(count_buffer, "%d", num_commands);
+			std::string message = shape_type_names[p_best->type];
+			message += " replaced ";
+			message += count_buffer;
+			message += " lines: ";
+			message += shape_gcode_;
+			p_logger_->log(logger_type_, DEBUG, message);
+		}
+		write_gcode_to_file(shape_gcode_, shape_comment_);
+		// The shape ends exactly where the lines did
+		const unwritten_command& last = shape_commands_[num_commands - 1];
+		unreliable_parameters_ &= ~(PARAMETER_X | PARAMETER_Y | (last.is_extruder_relative ? PARAMETER_NONE : PARAMETER_E) | (get_run_f_parameter_(num_commands) != NULL ? PARAMETER_F : PARAMETER_NONE));
+	}
+
+	for (int index = shape_commands_.count() - 1; index >= num_commands; index--)
+	{
+		pending_shape_commands_.push_front() = shape_commands_[index];
+	}
+	shape_commands_.clear();
+	for (int index = 0; index < shape_competitor_count_; index++)
+	{
+		shape_competitor& competitor = shape_competitors_[index];
+		competitor.p_shape->clear();
+		competitor.num_commands = 0;
+		competitor.is_growing = false;
+	}
+}
+
+// Writes every held line, as shapes where they fit
+void arc_welder::write_shapes_()
+{
+	while (shape_commands_.count() > 0)
+	{
+		write_best_shape_();
+		while (pending_shape_commands_.count() > 0 && try_add_to_shapes_(pending_shape_commands_[0]))
+		{
+			shape_commands_.push_back() = pending_shape_commands_[0];
+			pending_shape_commands_.pop_front();
+		}
 	}
-	return gcode;
-	
 }
 
-std::string arc_welder::get_arc_gcode_absolute(double e, double f, const std::string comment)
+// Builds the command that replaces the lines the shape holds, and returns its length.  The shape ends where the last
+// line does, with the exact sum of the relative e values, or the exact absolute e of the last line.
+double arc_welder::get_shape_gcode_(const shape_competitor& competitor, std::string& gcode)
 {
-	// Write gcode to file
-	std::string gcode;
+	int num_commands = competitor.num_commands;
+	const unwritten_command& last = shape_commands_[num_commands - 1];
+	double length = competitor.p_shape->get_shape_gcode_words(parameter_format_, gcode);
+	append_gcode_parameter_(gcode, 'X', last.end_x_fixed, true);
+	append_gcode_parameter_(gcode, 'Y', last.end_y_fixed, true);
+	append_gcode_parameter_(gcode, 'E', get_run_e_fixed_(num_commands), false);
+	const parsed_command_parameter* p_f_parameter = get_run_f_parameter_(num_commands);
+	if (p_f_parameter != NULL)
+	{
+		append_gcode_parameter_(gcode, 'F', p_f_parameter->fixed_value, false);
+	}
+	return length;
+}
 
-	gcode = current_arc_.get_shape_gcode_absolute(e, f);
+long long arc_welder::get_run_e_fixed_(int num_commands) const
+{
+	const unwritten_command& last = shape_commands_[num_commands - 1];
+	if (!last.is_extruder_relative)
+	{
+		return last.offset_e_fixed;
+	}
+	long long e_fixed = 0;
+	for (int index = 0; index < num_commands; index++)
+	{
+		e_fixed += shape_commands_[index].e_relative_fixed;
+	}
+	return e_fixed;
+}
 
-	if (comment.length() > 0)
+// The lines of a run all have the same feedrate, so F is written once if any of them sets it
+const parsed_command_parameter* arc_welder::get_run_f_parameter_(int num_commands) const
+{
+	for (int index = 0; index < num_commands; index++)
 	{
-		gcode += ";" + comment;
+		const unwritten_command& command = shape_commands_[index];
+		if (command.redundant_parameters & ~unreliable_parameters_ & PARAMETER_F)
+		{
+			continue;
+		}
+		for (std::vector<parsed_command_parameter>::const_iterator it = command.command.parameters.begin(); it != command.command.parameters.end(); ++it)
+		{
+			if (it->name == "F")
+			{
+				return &(*it);
+			}
+		}
 	}
-	return gcode;
+	return NULL;
+}
 
+// Build the comment the same way as for arcs
+void arc_welder::get_run_comment_(int num_commands, std::string& comment) const
+{
+	comment.clear();
+	for (int index = 0; index < num_commands; index++)
+	{
+		const std::string& old_comment = shape_commands_[index].command.comment;
+		if (old_comment != comment && old_comment.length() > 0)
+		{
+			if (comment.length() > 0)
+			{
+				comment += " - ";
+			}
+			comment += old_comment;
+		}
+	}
+}
+
+const char* arc_welder::get_comment_block_end(const std::string& comment)
+{
+	for (int index = 0; index < comment_block_markers_count; index++)
+	{
+		if (comment_starts_with(comment.c_str(), comment_block_markers[index].begin))
+		{
+			return comment_block_markers[index].end;
+		}
+	}
+	return NULL;
+}
+
+bool arc_welder::is_comment_line(const std::string& line)
+{
+	// Empty and whitespace only lines are allowed within a comment block
+	for (std::string::size_type index = 0; index < line.length(); index++)
+	{
+		char c = line[index];
+		if (c == ';')
+			return true;
+		if (c != ' ' && c != '\t' && c != '\r')
+			return false;
+	}
+	return true;
+}
+
+bool arc_welder::comment_starts_with(const char* comment, const char* marker)
+{
+	while (*comment == ' ')
+		comment++;
+	while (*marker != '\0')
+	{
+		if (*comment++ != *marker++)
+			return false;
+	}
+	return true;
+}
+
+void arc_welder::append_comment_line(const std::string& line, std::string& buffer)
+{
+	// This must produce the same text as parsed_command::to_string, which strips line breaks from the comment
+	// and drops the semicolon if the comment is empty.
+	std::string::size_type comment_start = line.find(';');
+	if (comment_start == std::string::npos)
+	{
+		buffer.append(line);
+	}
+	else
+	{
+		buffer.append(line, 0, comment_start);
+		std::string::size_type comment_length = 0;
+		for (std::string::size_type index = comment_start + 1; index < line.length(); index++)
+		{
+			if (line[index] != '\r' && line[index] != '\n')
+			{
+				if (comment_length++ == 0)
+					buffer.push_back(';');
+				buffer.push_back(line[index]);
+			}
+		}
+	}
+	buffer.push_back('\n');
+}
+
+void arc_welder::write_comment_block_to_file()
+{
+	allocation_stage_scope write_scope(allocation_stage_write);
+	if (comment_block_buffer_.length() == 0)
+		return;
+	output_file_.write(comment_block_buffer_.c_str(), comment_block_buffer_.length());
+	comment_block_buffer_.clear();
 }
 
 void arc_welder::add_arcwelder_comment_to_target()
@@ -737,7 +1876,68 @@ void arc_welder::add_arcwelder_comment_to_target()
 	stream <<	"; Postprocessed by [ArcWelder](https://github.com/FormerLurker/ArcWelderLib)\n";
 	stream << "; Copyright(C) 2020 - Brad Hochgesang\n";
 	stream << "; arc_welder_resolution_mm = " << resolution_mm_ << "\n";
-	stream << "; arc_welder_g90_influences_extruder = " << (gcode_position_args_.g90_influences_extruder ? "True" : "False") << "\n\n";
+	stream << "; arc_welder_g90_influences_extruder = " << (gcode_position_args_.g90_influences_extruder ? "True" : "False") << "\n";
+	if (use_fixed_point_)
+	{
+		stream << "; arc_welder_use_fixed_point = True\n";
+	}
+	if (current_arc_.get_use_least_squares_fit())
+	{
+		stream << "; arc_welder_use_least_squares_fit = True\n";
+	}
+	if (current_arc_.get_use_lookahead())
+	{
+		stream << "; arc_welder_use_lookahead = True\n";
+	}
+	if (current_arc_.get_use_segment_optimizer())
+	{
+		stream << "; arc_welder_use_segment_optimizer = True\n";
+	}
+	if (current_arc_.get_allow_helical_arcs())
+	{
+		stream << "; arc_welder_allow_helical_arcs = True\n";
+	}
+	if (allow_travel_arcs_)
+	{
+		stream << "; arc_welder_allow_travel_arcs = True\n";
+	}
+	if (allow_g0_travel_arcs_)
+	{
+		stream << "; arc_welder_allow_g0_travel_arcs = True\n";
+	}
+	if (use_line_simplification_)
+	{
+		stream << "; arc_welder_use_line_simplification = True\n";
+	}
+	if (remove_redundant_commands_)
+	{
+		stream << "; arc_welder_remove_redundant_commands = True\n";
+	}
+	if (minify_gcode_)
+	{
+		stream << "; arc_welder_minify_gcode = True\n";
+	}
+	if (minify_gcode_remove_spaces_)
+	{
+		stream << "; arc_welder_minify_gcode_remove_spaces = True\n";
+	}
+	if (allow_r_arcs_)
+	{
+		stream << "; arc_welder_allow_r_arcs = True\n";
+	}
+	if (allow_bezier_curves_)
+	{
+		stream << "; arc_welder_allow_bezier_curves = True\n";
+	}
+	if (current_arc_.get_min_segments() != DEFAULT_MIN_SEGMENTS)
+	{
+		stream << "; arc_welder_min_segments = " << current_arc_.get_min_segments() << "\n";
+	}
+	if (current_arc_.get_max_segments() != DEFAULT_MAX_ARC_SEGMENTS)
+	{
+		stream << "; arc_welder_max_segments = " << current_arc_.get_max_segments() << "\n";
+	}
+	stream << "\n";
 	
 	output_file_ << stream.str();
 }
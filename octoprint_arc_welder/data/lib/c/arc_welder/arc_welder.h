@@ -31,12 +31,16 @@
 #include "position.h"
 #include "gcode_parser.h"
 #include "segmented_arc.h"
+#include "segmented_line.h"
+#include "segmented_bezier.h"
 #include <iostream>
 #include <fstream>
 #include "array_list.h"
 #include "unwritten_command.h"
 #include "logger.h"
+#include "allocation_counter.h"
 #include <cmath>
+#include <chrono>
 
 #ifdef _MSC_VER
 #define _CRT_SECURE_NO_WARNINGS
@@ -44,10 +48,136 @@
 
 
 #define DEFAULT_G90_G91_INFLUENCES_EXTREUDER false
+#define DEFAULT_USE_FIXED_POINT false
+#define DEFAULT_ALLOW_TRAVEL_ARCS false
+#define DEFAULT_ALLOW_G0_TRAVEL_ARCS false
+#define DEFAULT_REMOVE_REDUNDANT_COMMANDS false
+#define DEFAULT_MINIFY_GCODE false
+#define DEFAULT_MINIFY_GCODE_REMOVE_SPACES false
+// Minified coordinates are rounded by at most this fraction of the resolution
+#define MINIFY_GCODE_MAX_ERROR_RATIO 0.1
+#define DEFAULT_ALLOW_R_ARCS false
+// Arcs are only written with R if the firmware draws them within this fraction of the resolution of the I and J arc
+#define R_ARC_MAX_PATH_ERROR_RATIO 0.1
+// The most points an arc can have.  This was the limit set by the 50 command gcode buffer before it was configurable.
+#define DEFAULT_MAX_ARC_SEGMENTS 45
+// The most points max_segments can be set to.  The buffers for the points and commands of an arc are allocated up
+// front, at about 8KB per point, so this keeps them under 40MB.
+#define MAX_ARC_SEGMENTS_LIMIT 5000
+// The gcode buffer holds the commands of the longest arc, plus this many
+#define GCODE_BUFFER_EXTRA_SIZE 5
+// The number of lines to process before counting steady state allocations
+#define ALLOCATION_WARM_UP_LINES 10000
+
+// Comment blocks (thumbnails, slicer settings) that are copied to the target without being processed.
+// The markers are matched against the start of the comment, ignoring leading whitespace.
+struct comment_block_marker {
+	const char* begin;
+	const char* end;
+};
+static const int comment_block_markers_count = 4;
+static const comment_block_marker comment_block_markers[] = {
+	{ "thumbnail begin", "thumbnail end" },
+	{ "thumbnail_JPG begin", "thumbnail_JPG end" },
+	{ "thumbnail_QOI begin", "thumbnail_QOI end" },
+	{ "prusaslicer_config = begin", "prusaslicer_config = end" }
+};
+// Flush the comment block buffer once it gets this large
+#define COMMENT_BLOCK_MAX_BUFFER_SIZE 1048576
 
 static const int segment_statistic_lengths_count = 12;
 const double segment_statistic_lengths[] = { 0.002f, 0.005f, 0.01f, 0.05f, 0.1f, 0.5f, 1.0f, 5.0f, 10.0f, 20.0f, 50.0f, 100.0f };
 
+// The shapes that compete for the runs of lines that were not welded into arcs (see
+// arc_welder::write_shape_command_).  A new type of shape needs a segmented_shape that writes its own command (see
+// segmented_shape::get_shape_gcode_words), an entry here and in shape_type_names, and a competitor in the constructor.
+enum shape_type
+{
+	SHAPE_TYPE_ARC = 0,
+	SHAPE_TYPE_LINE,
+	SHAPE_TYPE_CURVE,
+	SHAPE_TYPE_COUNT
+};
+static const char* const shape_type_names[] = { "Arc", "Line", "Curve" };
+
+// How often one type of shape replaced a run of lines.  A contested run is one that another shape could also have
+// replaced, but with fewer lines, or with the same lines while saving fewer bytes.
+struct shape_statistic {
+	shape_statistic()
+	{
+		is_enabled = false;
+		runs_replaced = 0;
+		lines_replaced = 0;
+		contested_runs_won = 0;
+		bytes_saved = 0;
+	}
+	bool is_enabled;
+	long long runs_replaced;
+	long long lines_replaced;
+	long long contested_runs_won;
+	long long bytes_saved;
+};
+
+struct shape_competition_statistics {
+	shape_statistic shapes[SHAPE_TYPE_COUNT];
+
+	bool has_enabled_shapes() const {
+		for (int index = 0; index < SHAPE_TYPE_COUNT; index++)
+		{
+			if (shapes[index].is_enabled)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::string str() const {
+		std::stringstream output_stream;
+		const int name_col_size = 8;
+		const int count_col_size = 12;
+		int table_width = name_col_size + count_col_size * 4;
+		output_stream << std::setw(name_col_size) << std::left << "Shape";
+		output_stream << std::setw(count_col_size) << std::right << "Runs";
+		output_stream << std::setw(count_col_size) << std::right << "Lines";
+		output_stream << std::setw(count_col_size) << std::right << "Contested";
+		output_stream << std::setw(count_col_size) << std::right << "Bytes Saved";
+		output_stream << "\n";
+		output_stream << std::setw(table_width) << std::setfill('-') << "" << std::setfill(' ');
+		for (int index = 0; index < SHAPE_TYPE_COUNT; index++)
+		{
+			const shape_statistic& shape = shapes[index];
+			if (!shape.is_enabled)
+			{
+				continue;
+			}
+			output_stream << "\n";
+			output_stream << std::setw(name_col_size) << std::left << shape_type_names[index];
+			output_stream << std::setw(count_col_size) << std::right << shape.runs_replaced;
+			output_stream << std::setw(count_col_size) << std::right << shape.lines_replaced;
+			output_stream << std::setw(count_col_size) << std::right << shape.contested_runs_won;
+			output_stream << std::setw(count_col_size) << std::right << shape.bytes_saved;
+		}
+		return output_stream.str();
+	}
+};
+
+// A shape taking part in the competition for the current run of lines
+struct shape_competitor {
+	shape_competitor()
+	{
+		type = SHAPE_TYPE_ARC;
+		p_shape = NULL;
+		num_commands = 0;
+		is_growing = false;
+	}
+	shape_type type;
+	segmented_shape* p_shape;
+	// The shape holds this many commands from the start of the run, and takes more until one doesn't fit.
+	int num_commands;
+	bool is_growing;
+};
+
 struct segment_statistic {
 	segment_statistic(double min_length_mm, double max_length_mm)
 	{
@@ -58,7 +188,7 @@ struct segment_statistic {
 
 	double min_mm;
 	double max_mm;
-	int count;
+	long long count;
 };
 
 struct source_target_segment_statistics {
@@ -91,8 +221,8 @@ struct source_target_segment_statistics {
 	double total_length_target;
 	int max_width;
 	int max_precision;
-	int total_count_source;
-	int total_count_target;
+	long long total_count_source;
+	long long total_count_target;
 	int num_segment_tracking_lengths;
 
 	void update(double length, bool is_source)
@@ -138,13 +268,13 @@ struct source_target_segment_statistics {
 		int count_col_size;
 
 		// Calculate the count column size
-		int max_count = 0;
+		long long max_count = 0;
 		//if (p_logger_ != NULL) p_logger_->log(logger_type_, VERBOSE, "Calculating Column Size.");
 
 		for (int index = 0; index < source_segments.size(); index++)
 		{
-			int source_count = source_segments[index].count;
-			int target_count = target_segments[index].count;
+			long long source_count = source_segments[index].count;
+			long long target_count = target_segments[index].count;
 			if (max_count < source_count)
 			{
 				max_count = source_count;
@@ -193,8 +323,8 @@ struct source_target_segment_statistics {
 			//extract the necessary variables from the source and target segments
 			double min_mm = source_segments[index].min_mm;
 			double max_mm = source_segments[index].max_mm;
-			int source_count = source_segments[index].count;
-			int target_count = target_segments[index].count;
+			long long source_count = source_segments[index].count;
+			long long target_count = target_segments[index].count;
 			// Calculate the percent change	and create the string
 			// Construct the percent_change_string
 			std::string percent_change_string = utilities::get_percent_change_string(source_count, target_count, 1);
@@ -319,25 +449,56 @@ struct arc_welder_progress {
 		lines_processed = 0;
 		points_compressed = 0;
 		arcs_created = 0;
+		lines_simplified = 0;
+		line_points_compressed = 0;
+		redundant_moves_removed = 0;
+		redundant_feedrates_removed = 0;
+		redundant_axes_removed = 0;
+		redundant_fan_commands_removed = 0;
+		redundant_g92_commands_removed = 0;
+		r_arcs_written = 0;
+		r_arc_bytes_saved = 0;
+		curves_created = 0;
+		curve_points_compressed = 0;
 		source_file_size = 0;
 		source_file_position = 0;
 		target_file_size = 0;
 		compression_ratio = 0;
 		compression_percent = 0;
-
+		fit_validations = 0;
+		fit_seconds = 0;
 	}
 	double percent_complete;
 	double seconds_elapsed;
 	double seconds_remaining;
-	int gcodes_processed;
-	int lines_processed;
-	int points_compressed;
-	int arcs_created;
+	long long gcodes_processed;
+	long long lines_processed;
+	long long points_compressed;
+	long long arcs_created;
+	// The lines that replaced runs of nearly collinear lines, and the number of lines they removed
+	long long lines_simplified;
+	long long line_points_compressed;
+	// The commands and parameters that were removed because they would not have changed anything
+	long long redundant_moves_removed;
+	long long redundant_feedrates_removed;
+	long long redundant_axes_removed;
+	long long redundant_fan_commands_removed;
+	long long redundant_g92_commands_removed;
+	// The arcs that were written with R because it was shorter than I and J, and the bytes that saved
+	long long r_arcs_written;
+	long long r_arc_bytes_saved;
+	// The G5 curves that replaced runs of lines, and the number of lines they removed
+	long long curves_created;
+	long long curve_points_compressed;
+	shape_competition_statistics shape_statistics;
 	double compression_ratio;
 	double compression_percent;
-	long source_file_position;
-	long source_file_size;
-	long target_file_size;
+	long long source_file_position;
+	long long source_file_size;
+	long long target_file_size;
+	// The number of circles checked against the points, and the time spent fitting arcs
+	long long fit_validations;
+	double fit_seconds;
 	source_target_segment_statistics segment_statistics;
 
 	std::string str() const {
@@ -349,6 +510,15 @@ struct arc_welder_progress {
 		stream << ", Current Line: " << lines_processed;
 		stream << ", Points Compressed: " << points_compressed;
 		stream << ", ArcsCreated: " << arcs_created;
+		stream << ", Lines Simplified: " << lines_simplified;
+		stream << ", Line Points Compressed: " << line_points_compressed;
+		stream << ", Redundant Moves Removed: " << redundant_moves_removed;
+		stream << ", Redundant Feedrates Removed: " << redundant_feedrates_removed;
+		stream << ", Redundant Axes Removed: " << redundant_axes_removed;
+		stream << ", Redundant Fan Commands Removed: " << redundant_fan_commands_removed;
+		stream << ", Redundant G92 Commands Removed: " << redundant_g92_commands_removed;
+		stream << ", R Arcs Written: " << r_arcs_written;
+		stream << ", R Arc Bytes Saved: " << r_arc_bytes_saved;
 		stream << ", Compression Ratio: " << compression_ratio;
 		stream << ", Size Reduction: " << compression_percent << "% ";
 		return stream.str();
@@ -356,6 +526,10 @@ struct arc_welder_progress {
 	std::string detail_str() const {
 		std::stringstream stream;
 		stream << "\n" << "Extrusion/Retraction Counts" << "\n" << segment_statistics.str() << "\n";
+		if (shape_statistics.has_enabled_shapes())
+		{
+			stream << "\n" << "Shape Counts" << "\n" << shape_statistics.str() << "\n";
+		}
 		return stream.str();
 	}
 };
@@ -374,12 +548,115 @@ struct arc_welder_results {
 	bool cancelled;
 	std::string message;
 	arc_welder_progress progress;
+	// Only counted when built with ARC_WELDER_COUNT_ALLOCATIONS
+	allocation_counts allocations;
+	allocation_counts steady_state_allocations;
+};
+
+struct arc_welder_args {
+	arc_welder_args()
+	{
+		source_path = "";
+		target_path = "";
+		log = NULL;
+		resolution_mm = DEFAULT_RESOLUTION_MM;
+		max_radius_mm = DEFAULT_MAX_RADIUS_MM;
+		g90_g91_influences_extruder = DEFAULT_G90_G91_INFLUENCES_EXTREUDER;
+		use_fixed_point = DEFAULT_USE_FIXED_POINT;
+		use_least_squares_fit = DEFAULT_USE_LEAST_SQUARES_FIT;
+		use_lookahead = DEFAULT_USE_LOOKAHEAD;
+		use_segment_optimizer = DEFAULT_USE_SEGMENT_OPTIMIZER;
+		allow_helical_arcs = DEFAULT_ALLOW_HELICAL_ARCS;
+		allow_travel_arcs = DEFAULT_ALLOW_TRAVEL_ARCS;
+		allow_g0_travel_arcs = DEFAULT_ALLOW_G0_TRAVEL_ARCS;
+		use_line_simplification = DEFAULT_USE_LINE_SIMPLIFICATION;
+		remove_redundant_commands = DEFAULT_REMOVE_REDUNDANT_COMMANDS;
+		minify_gcode = DEFAULT_MINIFY_GCODE;
+		minify_gcode_remove_spaces = DEFAULT_MINIFY_GCODE_REMOVE_SPACES;
+		allow_r_arcs = DEFAULT_ALLOW_R_ARCS;
+		allow_bezier_curves = DEFAULT_ALLOW_BEZIER_CURVES;
+		min_segments = DEFAULT_MIN_SEGMENTS;
+		max_segments = DEFAULT_MAX_ARC_SEGMENTS;
+		callback = NULL;
+	}
+	std::string source_path;
+	std::string target_path;
+	logger* log;
+	double resolution_mm;
+	double max_radius_mm;
+	bool g90_g91_influences_extruder;
+	// Compare positions and write arcs using the fixed point values from the parser.  Only circle fitting uses doubles,
+	// and the arc E values are exact sums of the source values, so there is no E drift.
+	bool use_fixed_point;
+	// Fit arcs with a least squares circle through every point instead of a circle through three of them.
+	bool use_least_squares_fit;
+	// Check arc points in exponentially growing batches instead of as each one is added.  Every point is still checked
+	// in order, so the arcs are the same.
+	bool use_lookahead;
+	// Collect each run of moves (up to the buffer size) and choose where its arcs start and end so that it needs as few
+	// commands as possible, instead of growing every arc as far as it will go.
+	bool use_segment_optimizer;
+	// Allow arcs that change Z linearly along their length (G2/G3 with Z), such as the spirals of vase mode prints.
+	// The firmware must support helical arcs.
+	bool allow_helical_arcs;
+	// Weld runs of G1 moves that neither extrude nor retract, such as curved travel moves and the moves of laser
+	// engraver and pen plotter jobs.
+	bool allow_travel_arcs;
+	// Also weld runs of G0 travel moves (requires allow_travel_arcs).  The arcs are written as G2/G3, so this is only
+	// safe when the firmware treats G0 like G1.  Never enable it for lasers that only switch off for G0 moves.
+	bool allow_g0_travel_arcs;
+	// Replace runs of nearly collinear G1 extrusions with a single line, as long as the path stays within the
+	// resolution and the extrusion per mm stays the same.  Only absolute XYZ (G90) moves are simplified.  Arcs, lines
+	// and curves then compete for the same runs of extrusions, and the shape that replaces the most of them is written
+	// (see arc_welder::write_shape_command_).
+	bool use_line_simplification;
+	// Remove commands that would not change anything:  moves to the current position, G92 E commands that set the
+	// current E, and fan commands that repeat the previous one.  Feedrates and axis values that are already set are
+	// removed from the moves that are kept.
+	bool remove_redundant_commands;
+	// Write arcs, simplified lines and G0/G1 moves with as few characters as possible.  Absolute coordinates get the
+	// fewest decimals that keep them within a tenth of the resolution, E and relative values are only trimmed, and
+	// leading and trailing zeros are removed (X.5).
+	bool minify_gcode;
+	// Also leave out the spaces between the parameters of minified commands (G1X10Y.5E.02).  Marlin, Klipper and
+	// RepRapFirmware accept this, but check before using it with other firmware.  Requires minify_gcode.
+	bool minify_gcode_remove_spaces;
+	// Write each arc with R instead of I and J when that is shorter and the firmware will find the same center.  Arcs
+	// close to a half or full circle, and tiny arcs, always use I and J.  The firmware must support the R form, which
+	// Marlin and RepRapFirmware do, but Klipper does not.
+	bool allow_r_arcs;
+	// Replace runs of G1 extrusions that curve without being circular with a cubic Bezier curve (G5), when the curve
+	// replaces more of them than an arc would.  Only absolute XYZ (G90) moves at one height are replaced.  Marlin needs
+	// BEZIER_CURVE_SUPPORT enabled, and most other firmware does not support G5 at all.
+	bool allow_bezier_curves;
+	// The fewest and most points an arc can have.  The gcode buffer is sized to fit the longest arc.  Each point is
+	// checked against all of the points before it, so an arc of n points takes O(n^2) work, with or without the
+	// lookahead.  Limits much above the default make long arcs noticeably slower to find.
+	int min_segments;
+	int max_segments;
+	progress_callback callback;
+};
+
+// Adds the time spent in its scope to a running total
+class fit_timer_scope
+{
+public:
+	fit_timer_scope(double& total_seconds) : total_seconds_(total_seconds), start_(std::chrono::steady_clock::now())
+	{
+	}
+	~fit_timer_scope()
+	{
+		total_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+	}
+private:
+	double& total_seconds_;
+	std::chrono::steady_clock::time_point start_;
 };
 
 class arc_welder
 {
 public:
-	arc_welder(std::string source_path, std::string target_path, logger* log, double resolution_mm, double max_radius, bool g90_g91_influences_extruder, int buffer_size, progress_callback callback = NULL);
+	arc_welder(arc_welder_args args);
 	void set_logger_type(int logger_type);
 	virtual ~arc_welder();
 	arc_welder_results process();
@@ -387,37 +664,130 @@ public:
 protected:
 	virtual bool on_progress_(const arc_welder_progress& progress);
 private:
-	arc_welder_progress get_progress_(long source_file_position, double start_clock);
+	arc_welder_progress get_progress_(long long source_file_position, double start_clock);
 	void add_arcwelder_comment_to_target();
 	void reset();
 	static gcode_position_args get_args_(bool g90_g91_influences_extruder, int buffer_size);
 	progress_callback progress_callback_;
-	int process_gcode(parsed_command cmd, bool is_end, bool is_reprocess);
-	int write_gcode_to_file(std::string gcode);
-	std::string get_arc_gcode_relative(double f, const std::string comment);
-	std::string get_arc_gcode_absolute(double e, double f, const std::string comment);
-	std::string get_comment_for_arc();
+	int process_gcode(parsed_command& cmd, bool is_end, bool is_reprocess);
+	void reprocess_commands_();
+	void add_arc_to_unwritten_commands_(const position* p_start_pos, const position* p_end_pos);
+	void process_window_(parsed_command& cmd, bool is_end);
+	int write_gcode_to_file(const std::string& gcode, const std::string& comment);
+	int write_gcode_to_file(const unwritten_command& command);
+	void get_comment_for_arc(std::string& comment);
+	long long get_arc_e_relative_fixed();
+	bool has_same_z_and_offsets(const position* p_cur_pos, const position* p_pre_pos) const;
+	bool has_same_offsets(const position* p_cur_pos, const position* p_pre_pos) const;
+	bool is_travel_point_allowed(const parsed_command& cmd, const extruder& previous_extruder, const extruder& extruder_current) const;
+	static bool has_only_motion_parameters(const parsed_command& cmd);
 	int write_unwritten_gcodes_to_file();
+	bool is_line_point_(const parsed_command& cmd, const position* p_cur_pos, const position* p_pre_pos) const;
+	static bool can_extend_line(const unwritten_command& previous, const unwritten_command& command);
+	void add_shape_competitor_(shape_type type, segmented_shape* p_shape);
+	void write_shape_command_(const unwritten_command& command);
+	bool try_add_to_shapes_(const unwritten_command& command);
+	void write_best_shape_();
+	void write_shapes_();
+	double get_shape_gcode_(const shape_competitor& competitor, std::string& gcode);
+	long long get_run_e_fixed_(int num_commands) const;
+	const parsed_command_parameter* get_run_f_parameter_(int num_commands) const;
+	void get_run_comment_(int num_commands, std::string& comment) const;
+	int get_redundant_parameters_(const parsed_command& cmd, const position* p_cur_pos, const position* p_pre_pos) const;
+	static int get_absolute_parameters(const parsed_command& cmd, const position* p_cur_pos);
+	static int get_parameter_flag(const std::string& name);
+	bool is_redundant_fan_command_(const parsed_command& cmd);
+	void update_is_e_position_known_(const parsed_command& cmd, const position* p_cur_pos);
+	void get_trimmed_gcode_(const parsed_command& cmd, int redundant_parameters, int absolute_parameters, std::string& gcode);
+	static bool can_minify(const parsed_command& cmd);
+	void append_gcode_parameter_(std::string& gcode, char name, long long value, bool can_round);
+	static bool has_same_parameters(const parsed_command& cmd_1, const parsed_command& cmd_2);
+	static const char* get_comment_block_end(const std::string& comment);
+	static bool is_comment_line(const std::string& line);
+	static bool comment_starts_with(const char* comment, const char* marker);
+	static void append_comment_line(const std::string& line, std::string& buffer);
+	void write_comment_block_to_file();
 	std::string create_g92_e(double absolute_e);
 	std::string source_path_;
 	std::string target_path_;
 	double resolution_mm_;
+	bool use_fixed_point_;
+	bool allow_travel_arcs_;
+	bool allow_g0_travel_arcs_;
+	// True when the moves of the current travel arc are G0 moves.  G0 and G1 travel moves are never mixed.
+	bool is_g0_arc_;
+	bool use_line_simplification_;
+	bool remove_redundant_commands_;
+	bool minify_gcode_;
+	bool minify_gcode_remove_spaces_;
+	long long minify_max_error_fixed_;
+	// The minification settings, for the shapes that replace runs of lines
+	gcode_parameter_format parameter_format_;
+	bool allow_r_arcs_;
+	double r_arc_max_path_error_;
+	// How far from its source value the last written end point can be, which is where the firmware starts an arc
+	double r_arc_start_error_;
+	bool allow_bezier_curves_;
 	double max_segments_;
 	gcode_position_args gcode_position_args_;
-	long file_size_;
-	int lines_processed_;
-	int gcodes_processed_;
-	int last_gcode_line_written_;
-	int points_compressed_;
-	int arcs_created_;
+	long long file_size_;
+	long long lines_processed_;
+	long long gcodes_processed_;
+	long long last_gcode_line_written_;
+	long long points_compressed_;
+	long long arcs_created_;
+	long long redundant_moves_removed_;
+	long long redundant_feedrates_removed_;
+	long long redundant_axes_removed_;
+	long long redundant_fan_commands_removed_;
+	long long redundant_g92_commands_removed_;
+	long long r_arcs_written_;
+	long long r_arc_bytes_saved_;
 	source_target_segment_statistics segment_statistics_;
-	long get_file_size(const std::string& file_path);
+	static long long get_file_size(const std::string& file_path);
 	double get_time_elapsed(double start_clock, double end_clock);
 	double get_next_update_time() const;
 	bool waiting_for_arc_;
 	array_list<unwritten_command> unwritten_commands_;
 	segmented_arc current_arc_;
+	// Commands that follow a closed arc and need to be processed again, in order.  The source position has been
+	// rewound to the end of the arc, so there is one undone position for each of these.
+	array_list<parsed_command> commands_to_reprocess_;
+	parsed_command reprocess_command_;
+	// The commands of the window being planned by the segment optimizer
+	array_list<unwritten_command> window_commands_;
+	bool is_reprocessing_;
+	double fit_seconds_;
 	std::ofstream output_file_;
+	std::string comment_block_buffer_;
+	// Reused for every arc so that creating and writing one doesn't allocate once they are large enough.
+	std::string arc_comment_;
+	std::string arc_gcode_;
+	std::string r_arc_gcode_;
+	// Written lines are held here while the shapes compete for them (see write_shape_command_)
+	segmented_arc current_shape_arc_;
+	// Set when the extrusions are left to the arc that competes with the other shapes.  The segment optimizer plans
+	// the arcs of a whole window at once, so it keeps welding them before the shapes compete.
+	bool is_arc_competing_;
+	segmented_line current_line_;
+	segmented_bezier current_curve_;
+	shape_competitor shape_competitors_[SHAPE_TYPE_COUNT];
+	int shape_competitor_count_;
+	array_list<unwritten_command> shape_commands_;
+	// The lines after the end of the last shape that was written, which start the next run
+	array_list<unwritten_command> pending_shape_commands_;
+	std::string shape_comment_;
+	std::string shape_gcode_;
+	shape_competition_statistics shape_statistics_;
+	// The last fan command that was written, so that repeats of it can be removed
+	parsed_command previous_fan_command_;
+	bool has_previous_fan_command_;
+	// The parameters that may have been written with a different value than the source, since they were rounded when
+	// an arc was written.  These are not redundant until they are set again.
+	int unreliable_parameters_;
+	// The firmware's E position is unknown until it is set by a G92 or an absolute E move
+	bool is_e_position_known_;
+	std::string trimmed_gcode_;
 
 	// We don't care about the printer settings, except for g91 influences extruder.
 	gcode_position* p_source_position_;
@@ -0,0 +1,321 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "point_window.h"
+#include "utilities.h"
+#include <cmath>
+#include <cstring>
+#include <stddef.h>
+#ifdef ARC_WELDER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Align the arrays to 32 bytes, and round their size up to a multiple of 4 doubles
+#define POINT_WINDOW_ALIGNMENT 32
+#define POINT_WINDOW_DOUBLES_PER_ALIGNMENT 4
+
+point_window::point_window(int max_size)
+{
+	max_size_ = max_size;
+	count_ = 0;
+	int padded_size = ((max_size + POINT_WINDOW_DOUBLES_PER_ALIGNMENT - 1) / POINT_WINDOW_DOUBLES_PER_ALIGNMENT) * POINT_WINDOW_DOUBLES_PER_ALIGNMENT;
+	buffer_ = new double[padded_size * 2 + POINT_WINDOW_DOUBLES_PER_ALIGNMENT];
+	size_t address = reinterpret_cast<size_t>(buffer_);
+	size_t offset = (POINT_WINDOW_ALIGNMENT - (address % POINT_WINDOW_ALIGNMENT)) % POINT_WINDOW_ALIGNMENT;
+	x_ = buffer_ + offset / sizeof(double);
+	y_ = x_ + padded_size;
+}
+
+point_window::~point_window()
+{
+	delete[] buffer_;
+}
+
+void point_window::push_back(double x, double y)
+{
+	// The window is never larger than the arc's max segments, so this can't overflow
+	x_[count_] = x;
+	y_[count_] = y;
+	count_++;
+}
+
+void point_window::pop_back()
+{
+	if (count_ > 0)
+		count_--;
+}
+
+void point_window::pop_front()
+{
+	// This only happens before the arc has min_segments points, so the move is tiny.
+	if (count_ == 0)
+		return;
+	count_--;
+	std::memmove(x_, x_ + 1, count_ * sizeof(double));
+	std::memmove(y_, y_ + 1, count_ * sizeof(double));
+}
+
+void point_window::clear()
+{
+	count_ = 0;
+}
+
+int point_window::count() const
+{
+	return count_;
+}
+
+const double* point_window::get_x() const
+{
+	return x_;
+}
+
+const double* point_window::get_y() const
+{
+	return y_;
+}
+
+int point_window::get_first_point_off_circle(int start_index, const circle& c, double tolerance) const
+{
+	int index = start_index;
+#ifdef ARC_WELDER_USE_SSE2
+	// This must make exactly the same decisions as the scalar version.  SSE2 sqrt is correctly rounded, and the
+	// operations are done in the same order.
+	const __m128d sign_mask = _mm_set1_pd(-0.0);
+	const __m128d center_x = _mm_set1_pd(c.center.x);
+	const __m128d center_y = _mm_set1_pd(c.center.y);
+	const __m128d radius = _mm_set1_pd(c.radius);
+	const __m128d tolerance_v = _mm_set1_pd(tolerance);
+	const __m128d zero_tolerance = _mm_set1_pd(ZERO_TOLERANCE);
+	for (; index + 1 < count_; index += 2)
+	{
+		__m128d x_dif = _mm_sub_pd(_mm_loadu_pd(x_ + index), center_x);
+		__m128d y_dif = _mm_sub_pd(_mm_loadu_pd(y_ + index), center_y);
+		__m128d distance_from_center = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(x_dif, x_dif), _mm_mul_pd(y_dif, y_dif)));
+		__m128d difference_from_radius = _mm_andnot_pd(sign_mask, _mm_sub_pd(distance_from_center, radius));
+		// utilities::greater_than(difference_from_radius, tolerance)
+		__m128d is_greater = _mm_cmpgt_pd(difference_from_radius, tolerance_v);
+		__m128d is_equal = _mm_cmplt_pd(_mm_andnot_pd(sign_mask, _mm_sub_pd(difference_from_radius, tolerance_v)), zero_tolerance);
+		int failed = _mm_movemask_pd(_mm_andnot_pd(is_equal, is_greater));
+		if (failed != 0)
+		{
+			return (failed & 1) ? index : index + 1;
+		}
+	}
+#endif
+	return get_first_point_off_circle_scalar_(index, count_, c, tolerance);
+}
+
+int point_window::get_first_point_off_circle_scalar_(int start_index, int end_index, const circle& c, double tolerance) const
+{
+	for (int index = start_index; index < end_index; index++)
+	{
+		// Make sure the length from the center of our circle to the test point is 
+		// at or below our max distance.
+		double distance_from_center = utilities::get_cartesian_distance(x_[index], y_[index], c.center.x, c.center.y);
+		double difference_from_radius = std::abs(distance_from_center - c.radius);
+		if (utilities::greater_than(difference_from_radius, tolerance))
+		{
+			return index;
+		}
+	}
+	return -1;
+}
+
+int point_window::get_first_segment_off_circle(const circle& c, double tolerance) const
+{
+	return get_first_segment_off_circle(0, count_ - 1, c, tolerance);
+}
+
+int point_window::get_first_segment_off_circle(int start_index, int end_index, const circle& c, double tolerance) const
+{
+	int index = start_index;
+#ifdef ARC_WELDER_USE_SSE2
+	const __m128d sign_mask = _mm_set1_pd(-0.0);
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d center_x = _mm_set1_pd(c.center.x);
+	const __m128d center_y = _mm_set1_pd(c.center.y);
+	const __m128d radius = _mm_set1_pd(c.radius);
+	const __m128d tolerance_v = _mm_set1_pd(tolerance);
+	const __m128d zero_tolerance = _mm_set1_pd(ZERO_TOLERANCE);
+	const __m128d t_tolerance = _mm_set1_pd(CIRCLE_GENERATION_A_ZERO_TOLERANCE);
+	for (; index + 1 < end_index; index += 2)
+	{
+		__m128d x1 = _mm_loadu_pd(x_ + index);
+		__m128d y1 = _mm_loadu_pd(y_ + index);
+		__m128d segment_x = _mm_sub_pd(_mm_loadu_pd(x_ + index + 1), x1);
+		__m128d segment_y = _mm_sub_pd(_mm_loadu_pd(y_ + index + 1), y1);
+		// See segment::get_closest_perpendicular_point
+		__m128d num = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(center_x, x1), segment_x), _mm_mul_pd(_mm_sub_pd(center_y, y1), segment_y));
+		__m128d denom = _mm_add_pd(_mm_mul_pd(segment_x, segment_x), _mm_mul_pd(segment_y, segment_y));
+		__m128d t = _mm_div_pd(num, denom);
+		__m128d is_end_point = _mm_or_pd(
+			_mm_or_pd(_mm_cmplt_pd(t, zero), _mm_cmplt_pd(_mm_andnot_pd(sign_mask, t), t_tolerance)),
+			_mm_or_pd(_mm_cmpgt_pd(t, one), _mm_cmplt_pd(_mm_andnot_pd(sign_mask, _mm_sub_pd(t, one)), t_tolerance))
+		);
+		__m128d x_dif = _mm_sub_pd(_mm_add_pd(x1, _mm_mul_pd(t, segment_x)), center_x);
+		__m128d y_dif = _mm_sub_pd(_mm_add_pd(y1, _mm_mul_pd(t, segment_y)), center_y);
+		__m128d distance_from_center = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(x_dif, x_dif), _mm_mul_pd(y_dif, y_dif)));
+		__m128d difference_from_radius = _mm_andnot_pd(sign_mask, _mm_sub_pd(distance_from_center, radius));
+		__m128d is_greater = _mm_cmpgt_pd(difference_from_radius, tolerance_v);
+		__m128d is_equal = _mm_cmplt_pd(_mm_andnot_pd(sign_mask, _mm_sub_pd(difference_from_radius, tolerance_v)), zero_tolerance);
+		int failed = _mm_movemask_pd(_mm_andnot_pd(_mm_or_pd(is_end_point, is_equal), is_greater));
+		if (failed != 0)
+		{
+			return (failed & 1) ? index : index + 1;
+		}
+	}
+#endif
+	return get_first_segment_off_circle_scalar_(index, end_index, c, tolerance);
+}
+
+int point_window::get_first_segment_off_circle_scalar_(int start_index, int end_index, const circle& c, double tolerance) const
+{
+	for (int index = start_index; index < end_index; index++)
+	{
+		// The same math as segment::get_closest_perpendicular_point, without copying the points
+		double segment_x = x_[index + 1] - x_[index];
+		double segment_y = y_[index + 1] - y_[index];
+		double num = (c.center.x - x_[index]) * segment_x + (c.center.y - y_[index]) * segment_y;
+		double denom = segment_x * segment_x + segment_y * segment_y;
+		double t = num / denom;
+		// If the closest point is one of the end points, it has already been checked.
+		if (utilities::less_than_or_equal(t, 0, CIRCLE_GENERATION_A_ZERO_TOLERANCE) || utilities::greater_than_or_equal(t, 1, CIRCLE_GENERATION_A_ZERO_TOLERANCE))
+			continue;
+		double distance_from_center = utilities::get_cartesian_distance(x_[index] + t * segment_x, y_[index] + t * segment_y, c.center.x, c.center.y);
+		double difference_from_radius = std::abs(distance_from_center - c.radius);
+		if (utilities::greater_than(difference_from_radius, tolerance))
+		{
+			return index;
+		}
+	}
+	return -1;
+}
+
+least_squares_circle_fit::least_squares_circle_fit()
+{
+	clear();
+}
+
+void least_squares_circle_fit::clear()
+{
+	count_ = 0;
+	origin_x_ = 0;
+	origin_y_ = 0;
+	last_x_ = 0;
+	last_y_ = 0;
+	max_segment_length_sq_ = 0;
+	sx_ = 0;
+	sy_ = 0;
+	sxx_ = 0;
+	syy_ = 0;
+	sxy_ = 0;
+	sz_ = 0;
+	sxz_ = 0;
+	syz_ = 0;
+	szz_ = 0;
+}
+
+void least_squares_circle_fit::add(double x, double y)
+{
+	if (count_ == 0)
+	{
+		origin_x_ = x;
+		origin_y_ = y;
+	}
+	double local_x = x - origin_x_;
+	double local_y = y - origin_y_;
+	if (count_ > 0)
+	{
+		double segment_x = local_x - last_x_;
+		double segment_y = local_y - last_y_;
+		double segment_length_sq = segment_x * segment_x + segment_y * segment_y;
+		if (segment_length_sq > max_segment_length_sq_)
+			max_segment_length_sq_ = segment_length_sq;
+	}
+	last_x_ = local_x;
+	last_y_ = local_y;
+	double z = local_x * local_x + local_y * local_y;
+	count_++;
+	sx_ += local_x;
+	sy_ += local_y;
+	sxx_ += local_x * local_x;
+	syy_ += local_y * local_y;
+	sxy_ += local_x * local_y;
+	sz_ += z;
+	sxz_ += local_x * z;
+	syz_ += local_y * z;
+	szz_ += z * z;
+}
+
+int least_squares_circle_fit::count() const
+{
+	return count_;
+}
+
+double least_squares_circle_fit::get_max_segment_length() const
+{
+	return std::sqrt(max_segment_length_sq_);
+}
+
+bool least_squares_circle_fit::try_get_circle(circle& c, double& residual_sum) const
+{
+	if (count_ < 3)
+		return false;
+	// Minimize the sum of (z + Dx + Ey + F)^2 where z = x^2 + y^2.  Centering the sums on the mean reduces the
+	// normal equations to a 2x2 system for D and E.
+	double n = static_cast<double>(count_);
+	double mean_x = sx_ / n;
+	double mean_y = sy_ / n;
+	double mean_z = sz_ / n;
+	double cxx = sxx_ - sx_ * mean_x;
+	double cyy = syy_ - sy_ * mean_y;
+	double cxy = sxy_ - sx_ * mean_y;
+	double cxz = sxz_ - sx_ * mean_z;
+	double cyz = syz_ - sy_ * mean_z;
+	double czz = szz_ - sz_ * mean_z;
+	double determinant = cxx * cyy - cxy * cxy;
+	double scale = cxx + cyy;
+	// Collinear points have no circle
+	if (scale <= 0 || determinant <= scale * scale * 1e-12)
+		return false;
+	double d = (-cxz * cyy + cyz * cxy) / determinant;
+	double e = (-cyz * cxx + cxz * cxy) / determinant;
+	double f = -(mean_z + d * mean_x + e * mean_y);
+	double local_center_x = -d / 2.0;
+	double local_center_y = -e / 2.0;
+	double radius_sq = local_center_x * local_center_x + local_center_y * local_center_y - f;
+	if (radius_sq <= 0)
+		return false;
+	// At the minimum the residuals are orthogonal to x, y and 1, so the residual sum only needs these terms.
+	residual_sum = czz + d * cxz + e * cyz;
+	if (residual_sum < 0)
+		residual_sum = 0;
+	c.center.x = origin_x_ + local_center_x;
+	c.center.y = origin_y_ + local_center_y;
+	c.radius = std::sqrt(radius_sq);
+	return true;
+}
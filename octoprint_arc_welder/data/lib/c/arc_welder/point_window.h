@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "segmented_shape.h"
+
+// Use SSE2 for the fit checks where it is always available.  Define ARC_WELDER_NO_SIMD to use the scalar versions.
+#if !defined(ARC_WELDER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ARC_WELDER_USE_SSE2
+#endif
+
+// The X and Y coordinates of the points in an arc, stored in separate aligned arrays so that the fit checks can
+// test several points at once.  segmented_arc keeps this in sync with its point list.
+class point_window
+{
+public:
+	point_window(int max_size);
+	virtual ~point_window();
+	void push_back(double x, double y);
+	void pop_back();
+	void pop_front();
+	void clear();
+	int count() const;
+	const double* get_x() const;
+	const double* get_y() const;
+	// Returns the index of the first point, starting at start_index, whose distance from the circle is greater
+	// than the tolerance, or -1 if every point fits.
+	int get_first_point_off_circle(int start_index, const circle& c, double tolerance) const;
+	// Returns the index of the first segment (the index of its starting point) where the point closest to the center
+	// of the circle lies between the end points and is further than the tolerance from the circle, or -1 if every
+	// segment fits.
+	int get_first_segment_off_circle(const circle& c, double tolerance) const;
+	// The same, for the segments starting at start_index up to (but not including) end_index
+	int get_first_segment_off_circle(int start_index, int end_index, const circle& c, double tolerance) const;
+private:
+	point_window(const point_window& source);
+	point_window& operator=(const point_window& source);
+	int get_first_point_off_circle_scalar_(int start_index, int end_index, const circle& c, double tolerance) const;
+	int get_first_segment_off_circle_scalar_(int start_index, int end_index, const circle& c, double tolerance) const;
+	double* buffer_;
+	double* x_;
+	double* y_;
+	int count_;
+	int max_size_;
+};
+
+// Running sums for an algebraic (Kasa) least squares circle fit, so the circle can be updated in O(1) per point.
+// Coordinates are stored relative to the first point to reduce rounding error in the sums.
+struct least_squares_circle_fit
+{
+	least_squares_circle_fit();
+	void clear();
+	void add(double x, double y);
+	int count() const;
+	// Returns false if the points are (nearly) collinear.  residual_sum is the sum of the squared algebraic
+	// residuals (x^2 + y^2 + Dx + Ey + F), which gives an upper bound for the distance of any point from the circle.
+	bool try_get_circle(circle& c, double& residual_sum) const;
+	// The length of the longest segment added so far
+	double get_max_segment_length() const;
+private:
+	int count_;
+	double origin_x_;
+	double origin_y_;
+	double last_x_;
+	double last_y_;
+	double max_segment_length_sq_;
+	double sx_;
+	double sy_;
+	double sxx_;
+	double syy_;
+	double sxy_;
+	double sz_;
+	double sxz_;
+	double syz_;
+	double szz_;
+};
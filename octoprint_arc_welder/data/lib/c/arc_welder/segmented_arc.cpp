@@ -30,14 +30,38 @@
 #include <iomanip>
 #include <stdio.h>
 #include <cmath>
+#include <cstdlib>
 
-segmented_arc::segmented_arc() : segmented_shape(DEFAULT_MIN_SEGMENTS, DEFAULT_MAX_SEGMENTS, DEFAULT_RESOLUTION_MM)
+segmented_arc::segmented_arc() : segmented_shape(DEFAULT_MIN_SEGMENTS, DEFAULT_MAX_SEGMENTS, DEFAULT_RESOLUTION_MM), window_(DEFAULT_MAX_SEGMENTS), lookahead_(DEFAULT_MAX_SEGMENTS), window_points_(DEFAULT_MAX_SEGMENTS),
+	first_arc_ends_(DEFAULT_MAX_SEGMENTS), last_arc_ends_(DEFAULT_MAX_SEGMENTS), commands_to_point_(DEFAULT_MAX_SEGMENTS),
+	previous_points_(DEFAULT_MAX_SEGMENTS), planned_arc_ends_(DEFAULT_MAX_SEGMENTS)
 {
 	max_radius_mm_ = DEFAULT_MAX_RADIUS_MM;
+	use_least_squares_fit_ = DEFAULT_USE_LEAST_SQUARES_FIT;
+	use_lookahead_ = DEFAULT_USE_LOOKAHEAD;
+	lookahead_step_ = 1;
+	is_lookahead_rejected_ = false;
+	num_validations_ = 0;
+	use_segment_optimizer_ = DEFAULT_USE_SEGMENT_OPTIMIZER;
+	is_planning_ = false;
+	allow_helical_arcs_ = DEFAULT_ALLOW_HELICAL_ARCS;
+	num_arc_points_ = 0;
 }
 
-segmented_arc::segmented_arc(int min_segments, int max_segments, double resolution_mm, double max_radius_mm) : segmented_shape(min_segments, max_segments, resolution_mm)
+segmented_arc::segmented_arc(int min_segments, int max_segments, double resolution_mm, double max_radius_mm, bool use_least_squares_fit, bool use_lookahead, bool use_segment_optimizer, bool allow_helical_arcs) : segmented_shape(min_segments, use_segment_optimizer && max_segments > MAX_SEGMENT_OPTIMIZER_WINDOW ? MAX_SEGMENT_OPTIMIZER_WINDOW : max_segments, resolution_mm), window_(max_segments), lookahead_(max_segments),
+	window_points_(max_segments), first_arc_ends_(max_segments), last_arc_ends_(max_segments), commands_to_point_(max_segments),
+	previous_points_(max_segments), planned_arc_ends_(max_segments)
 {
+	use_least_squares_fit_ = use_least_squares_fit;
+	// The optimizer already decides where every arc ends
+	use_lookahead_ = use_lookahead && !use_segment_optimizer;
+	lookahead_step_ = 1;
+	is_lookahead_rejected_ = false;
+	num_validations_ = 0;
+	use_segment_optimizer_ = use_segment_optimizer;
+	is_planning_ = false;
+	allow_helical_arcs_ = allow_helical_arcs;
+	num_arc_points_ = 0;
 	if (max_radius_mm > DEFAULT_MAX_RADIUS_MM) max_radius_mm_ = DEFAULT_MAX_RADIUS_MM;
 	else max_radius_mm_ = max_radius_mm;
 }
@@ -46,6 +70,95 @@ segmented_arc::~segmented_arc()
 {
 }
 
+void segmented_arc::clear()
+{
+	segmented_shape::clear();
+	window_.clear();
+	fit_.clear();
+	lookahead_.clear();
+	lookahead_step_ = 1;
+	is_lookahead_rejected_ = false;
+	num_arc_points_ = 0;
+}
+
+void segmented_arc::push_point_(const point& p)
+{
+	points_.push_back(p);
+	window_.push_back(p.x, p.y);
+	if (p.arc_length > 0)
+		num_arc_points_++;
+	if (use_least_squares_fit_)
+		fit_.add(p.x, p.y);
+}
+
+point segmented_arc::pop_front_point_()
+{
+	window_.pop_front();
+	point p = points_.pop_front();
+	if (p.arc_length > 0)
+		num_arc_points_--;
+	rebuild_fit_();
+	return p;
+}
+
+point segmented_arc::pop_back_point_()
+{
+	window_.pop_back();
+	point p = points_.pop_back();
+	if (p.arc_length > 0)
+		num_arc_points_--;
+	rebuild_fit_();
+	return p;
+}
+
+void segmented_arc::rebuild_fit_()
+{
+	// The sums can't be reliably subtracted from, so start over.  Points are only removed when an arc ends, or
+	// before it has min_segments points.
+	if (!use_least_squares_fit_)
+		return;
+	fit_.clear();
+	for (int index = 0; index < window_.count(); index++)
+	{
+		fit_.add(window_.get_x()[index], window_.get_y()[index]);
+	}
+}
+
+bool segmented_arc::get_use_least_squares_fit() const
+{
+	return use_least_squares_fit_;
+}
+
+bool segmented_arc::get_use_lookahead() const
+{
+	return use_lookahead_;
+}
+
+int segmented_arc::get_num_lookahead_points() const
+{
+	return lookahead_.count();
+}
+
+long long segmented_arc::get_num_validations() const
+{
+	return num_validations_;
+}
+
+bool segmented_arc::get_allow_helical_arcs() const
+{
+	return allow_helical_arcs_;
+}
+
+bool segmented_arc::get_use_segment_optimizer() const
+{
+	return use_segment_optimizer_;
+}
+
+int segmented_arc::get_planned_arc_end(int start_index) const
+{
+	return planned_arc_ends_[start_index];
+}
+
 point segmented_arc::pop_front(double e_relative)
 {
 	e_relative_ -= e_relative;
@@ -53,12 +166,12 @@ point segmented_arc::pop_front(double e_relative)
 	{
 		set_is_shape(false);
 	}
-	return points_.pop_front();
+	return pop_front_point_();
 }
 point segmented_arc::pop_back(double e_relative)
 {
 	e_relative_ -= e_relative;
-	return points_.pop_back();
+	return pop_back_point_();
 	if (points_.count() == get_min_segments())
 	{
 		set_is_shape(false);
@@ -84,7 +197,7 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 	
 	bool point_added = false;
 	// if we don't have enough segnemts to check the shape, just add
-	if (points_.count() > get_max_segments() - 1)
+	if (points_.count() + lookahead_.count() > get_max_segments() - 1)
 	{
 		// Too many points, we can't add more
 		return false;
@@ -92,30 +205,45 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 	double distance = 0;
 	if (points_.count() > 0)
 	{
-		point p1 = points_[points_.count() - 1];
-		distance = utilities::get_cartesian_distance(p1.x, p1.y, p.x, p.y);
-		if (!utilities::is_equal(p1.z, p.z))
+		point p1 = lookahead_.count() > 0 ? lookahead_[lookahead_.count() - 1] : points_[points_.count() - 1];
+		distance = point::get_path_length(p1, p);
+		if (!allow_helical_arcs_ && !utilities::is_equal(p1.z, p.z))
 		{
-			// Arcs require that z is equal for all points
+			// Arcs require that z is equal for all points, unless they are helical
 			//std::cout << " failed - z change.\n";
 
 			return false;
 		}
 
-		if (utilities::is_zero(distance))
+		if (utilities::is_zero(distance) || (p.arc_length > 0 && utilities::is_zero(utilities::get_cartesian_distance(p1.x, p1.y, p.x, p.y))))
 		{
 			// there must be some distance between the points
-			// to make an arc.
+			// to make an arc.  An existing arc that ends where it starts is a full circle.
 			//std::cout << " failed - no distance change.\n";
 			return false;
 		}
 		
 	}
+
+	if (use_segment_optimizer_ && !is_planning_)
+	{
+		// Collect the point, it is checked when the window is planned
+		p.e_relative = e_relative;
+		push_point_(p);
+		original_shape_length_ += distance;
+		return true;
+	}
+
+	if (use_lookahead_ && is_shape())
+	{
+		// The arc has been found, the points are checked in batches from now on.
+		return try_add_lookahead_point_(p, e_relative);
+	}
 	
 	if (points_.count() < get_min_segments() - 1)
 	{
 		point_added = true;
-		points_.push_back(p);
+		push_point_(p);
 		original_shape_length_ += distance;
 		if (points_.count() == get_min_segments())
 		{
@@ -123,7 +251,7 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 			if (!arc::try_create_arc(arc_circle_, points_, original_shape_length_, resolution_mm_, a))
 			{
 				point_added = false;
-				points_.pop_back();
+				pop_back_point_();
 				original_shape_length_ -= distance;
 			}
 		}
@@ -149,11 +277,11 @@ bool segmented_arc::try_add_point(point p, double e_relative)
 	{
 		// If we haven't added a point, and we have exactly min_segments_,
 		// pull off the initial arc point and try again
-		point old_initial_point = points_.pop_front();
+		point old_initial_point = pop_front_point_();
 		// We have to remove the distance and e relative value
 		// accumulated between the old arc start point and the new
 		point new_initial_point = points_[0];
-		original_shape_length_ -= utilities::get_cartesian_distance(old_initial_point.x, old_initial_point.y, new_initial_point.x, new_initial_point.y);
+		original_shape_length_ -= point::get_path_length(old_initial_point, new_initial_point);
 		e_relative_ -= new_initial_point.e_relative;
 		//std::cout << " failed - removing start point and retrying current point.\n";
 		return try_add_point(p, e_relative);
@@ -168,6 +296,10 @@ bool segmented_arc::try_add_point_internal_(point p, double pd)
 	if (points_.count() < get_min_segments() - 1)
 		return false;
 	
+	num_validations_++;
+	if (use_least_squares_fit_)
+		return try_add_point_least_squares_(p, pd);
+	
 	// Create a test circle
 	circle test_circle;
 	bool circle_created;
@@ -182,7 +314,7 @@ bool segmented_arc::try_add_point_internal_(point p, double pd)
 		bool circle_fits_points;
 
 		// the circle is new..  we have to test it now, which is expensive :(
-		points_.push_back(p);
+		push_point_(p);
 		double previous_shape_length = original_shape_length_;
 		original_shape_length_ += pd;
 		
@@ -193,7 +325,7 @@ bool segmented_arc::try_add_point_internal_(point p, double pd)
 		}
 		else
 		{
-			points_.pop_back();
+			pop_back_point_();
 			original_shape_length_ = previous_shape_length;
 		}
 		
@@ -209,52 +341,252 @@ bool segmented_arc::try_add_point_internal_(point p, double pd)
 	
 }
 
-bool segmented_arc::does_circle_fit_points_(circle& c) const
+bool segmented_arc::try_add_lookahead_point_(point p, double e_relative)
 {
-	// We know point 1 must fit (we used it to create the circle).  Check the other points
-	// Note:  We have not added the current point, but that's fine since it is guaranteed to fit too.
-	// If this works, it will be added.
+	p.e_relative = e_relative;
+	lookahead_.push_back(p);
+	if (lookahead_.count() < lookahead_step_)
+		return true;
 
-	double distance_from_center;
-	double difference_from_radius;
-	
-	// Check the endpoints to make sure they fit the current circle
-	for (int index = 1; index < points_.count(); index++)
+	if (try_add_lookahead_points_())
+	{
+		lookahead_step_ *= 2;
+		return true;
+	}
+	// This point ends the arc, or comes after the one that does.  resolve_lookahead rejects the others that are left.
+	lookahead_.pop_back();
+	is_lookahead_rejected_ = true;
+	return false;
+}
+
+bool segmented_arc::try_add_lookahead_points_()
+{
+	// Check the waiting points in order, exactly as they would be checked point by point, until one doesn't fit.  On
+	// noisy paths an arc can fit a span and still fail on a shorter one, so skipping any of the checks could end the
+	// arc later than the point by point checks would.
+	while (lookahead_.count() > 0)
 	{
-		// Make sure the length from the center of our circle to the test point is 
-		// at or below our max distance.
-		distance_from_center = utilities::get_cartesian_distance(points_[index].x, points_[index].y, c.center.x, c.center.y);
-		double difference_from_radius = std::abs(distance_from_center - c.radius);
-		if (utilities::greater_than(difference_from_radius, resolution_mm_))
+		const point& previous_point = points_[points_.count() - 1];
+		const point& p = lookahead_[0];
+		if (!try_add_point_internal_(p, point::get_path_length(previous_point, p)))
 		{
-			//std::cout << " failed - end points do not lie on circle.\n";
 			return false;
 		}
+		e_relative_ += lookahead_.pop_front().e_relative;
 	}
-	
-	// Check the point perpendicular from the segment to the circle's center, if any such point exists
-	for (int index = 0; index < points_.count() - 1; index++)
+	return true;
+}
+
+int segmented_arc::resolve_lookahead()
+{
+	if (!is_lookahead_rejected_)
 	{
-		point point_to_test;
-		if (segment::get_closest_perpendicular_point(points_[index], points_[index + 1], c.center, point_to_test))
+		try_add_lookahead_points_();
+	}
+	int num_rejected = lookahead_.count();
+	lookahead_.clear();
+	is_lookahead_rejected_ = false;
+	return num_rejected;
+}
+
+void segmented_arc::plan_window()
+{
+	// Finding the arcs reuses points_, so copy the window first
+	window_points_.clear();
+	for (int index = 0; index < points_.count(); index++)
+	{
+		window_points_.push_back(points_[index]);
+	}
+	int num_points = window_points_.count();
+
+	// Grow an arc from every start point, keeping the range of end points where it is a valid arc.  Every shorter
+	// arc from the same start point passed along the way, so all of the ends in the range are valid.
+	is_planning_ = true;
+	for (int start_index = 0; start_index < num_points; start_index++)
+	{
+		first_arc_ends_[start_index] = -1;
+		last_arc_ends_[start_index] = -1;
+		if (num_points - start_index < get_min_segments())
+			continue;
+		clear();
+		try_add_point(window_points_[start_index], 0);
+		for (int end_index = start_index + 1; end_index < num_points; end_index++)
 		{
-			distance_from_center = utilities::get_cartesian_distance(point_to_test.x, point_to_test.y, c.center.x, c.center.y);
-			difference_from_radius = std::abs(distance_from_center - c.radius);
-			// Test allowing more play for the midpoints.
-			if (utilities::greater_than(difference_from_radius, resolution_mm_))
+			const point& p = window_points_[end_index];
+			// Stop if the point doesn't fit, or if the start point was dropped to make it fit
+			if (!try_add_point(p, p.e_relative) || get_num_segments() != end_index - start_index + 1)
+				break;
+			if (is_shape())
 			{
-				return false;
+				if (first_arc_ends_[start_index] == -1)
+					first_arc_ends_[start_index] = end_index;
+				last_arc_ends_[start_index] = end_index;
 			}
 		}
-		
+	}
+	is_planning_ = false;
+	clear();
+
+	// Find the fewest commands that reach each point, with either a line from the previous point or an arc.  Ties go
+	// to the line, then to the longest arc.
+	commands_to_point_[0] = 0;
+	previous_points_[0] = -1;
+	for (int end_index = 1; end_index < num_points; end_index++)
+	{
+		commands_to_point_[end_index] = commands_to_point_[end_index - 1] + 1;
+		previous_points_[end_index] = end_index - 1;
+		for (int start_index = 0; start_index < end_index - 1; start_index++)
+		{
+			if (
+				first_arc_ends_[start_index] != -1 &&
+				first_arc_ends_[start_index] <= end_index &&
+				last_arc_ends_[start_index] >= end_index &&
+				commands_to_point_[start_index] + 1 < commands_to_point_[end_index]
+			)
+			{
+				commands_to_point_[end_index] = commands_to_point_[start_index] + 1;
+				previous_points_[end_index] = start_index;
+			}
+		}
+	}
+
+	for (int index = 0; index < num_points; index++)
+	{
+		planned_arc_ends_[index] = -1;
+	}
+	for (int end_index = num_points - 1; end_index > 0; end_index = previous_points_[end_index])
+	{
+		if (previous_points_[end_index] < end_index - 1)
+			planned_arc_ends_[previous_points_[end_index]] = end_index;
+	}
+}
+
+bool segmented_arc::load_planned_arc(int start_index, int end_index)
+{
+	clear();
+	is_planning_ = true;
+	try_add_point(window_points_[start_index], 0);
+	for (int index = start_index + 1; index <= end_index; index++)
+	{
+		const point& p = window_points_[index];
+		try_add_point(p, p.e_relative);
+	}
+	is_planning_ = false;
+	return is_shape() && get_num_segments() == end_index - start_index + 1;
+}
+
+bool segmented_arc::try_add_point_least_squares_(point p, double pd)
+{
+	push_point_(p);
+	double previous_shape_length = original_shape_length_;
+	original_shape_length_ += pd;
+
+	circle test_circle;
+	double residual_sum;
+	bool circle_fits_points = fit_.try_get_circle(test_circle, residual_sum);
+	if (circle_fits_points)
+	{
+		// The arc is drawn around the fitted center, starting at the first point, so that is the radius the
+		// other points need to match.
+		const point& start_point = points_[0];
+		test_circle.center.z = start_point.z;
+		double fit_radius = test_circle.radius;
+		test_circle.radius = utilities::get_cartesian_distance(start_point.x, start_point.y, test_circle.center.x, test_circle.center.y);
+		circle_fits_points = test_circle.radius <= max_radius_mm_;
+		if (circle_fits_points)
+		{
+			// Every residual is (d^2 - r^2) = (d - r)(d + r), and no residual can be larger than the square root
+			// of their sum, so this bounds the distance of every point from the drawn circle.
+			double point_error = std::sqrt(residual_sum) / fit_radius + std::abs(test_circle.radius - fit_radius);
+			// The closest point of a segment to the center can be at most this far inside of the circle.
+			double inner_radius = test_circle.radius - point_error;
+			double half_segment_length = fit_.get_max_segment_length() / 2.0;
+			double segment_error = point_error;
+			if (inner_radius > half_segment_length)
+			{
+				double sagitta_error = test_circle.radius - std::sqrt(inner_radius * inner_radius - half_segment_length * half_segment_length);
+				if (sagitta_error > segment_error)
+					segment_error = sagitta_error;
+			}
+			else
+			{
+				segment_error = test_circle.radius;
+			}
+			if (segment_error > resolution_mm_ * LEAST_SQUARES_SKIP_CHECK_RATIO)
+			{
+				// The estimate is close to the resolution, check every point
+				circle_fits_points = does_circle_fit_points_(test_circle);
+			}
+			else
+			{
+				arc a;
+				circle_fits_points = try_get_arc_(test_circle, a);
+			}
+		}
+	}
+
+	if (circle_fits_points)
+	{
+		arc_circle_ = test_circle;
+	}
+	else
+	{
+		pop_back_point_();
+		original_shape_length_ = previous_shape_length;
+	}
+
+	// Only set is_shape if it goes from false to true
+	if (!is_shape())
+		set_is_shape(circle_fits_points);
+
+	return circle_fits_points;
+}
+
+bool segmented_arc::does_circle_fit_points_(circle& c) const
+{
+	// We know point 1 must fit (we used it to create the circle).  Check the other points
+	// Note:  We have not added the current point, but that's fine since it is guaranteed to fit too.
+	// If this works, it will be added.
+
+	// Check the endpoints to make sure they fit the current circle
+	if (window_.get_first_point_off_circle(1, c, resolution_mm_) != -1)
+	{
+		//std::cout << " failed - end points do not lie on circle.\n";
+		return false;
+	}
+	
+	// Check the point perpendicular from the segment to the circle's center, if any such point exists
+	if (num_arc_points_ == 0 ? window_.get_first_segment_off_circle(c, resolution_mm_) != -1 : !do_segments_fit_circle_(c))
+	{
+		return false;
 	}
 	
 	// get the current arc and compare the total length to the original length
 	arc a;
-	return arc::try_create_arc(c, points_, original_shape_length_, resolution_mm_, a);
+	return try_get_arc_(c, a);
 	
 }
 
+bool segmented_arc::does_z_fit_points_() const
+{
+	// The firmware moves Z in proportion to the distance travelled along the arc, so every point must be within the
+	// resolution of the height it would have at the same distance.
+	const point& start_point = points_[0];
+	double z_change = points_[points_.count() - 1].z - start_point.z;
+	double length = 0;
+	for (int index = 1; index < points_.count() - 1; index++)
+	{
+		const point& previous_point = points_[index - 1];
+		const point& p = points_[index];
+		length += point::get_path_length(previous_point, p);
+		if (!utilities::is_equal(p.z, start_point.z + z_change * length / original_shape_length_, resolution_mm_))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 bool segmented_arc::try_get_arc(arc & target_arc)																								 
 {
 	//int mid_point_index = ((points_.count() - 2) / 2) + 1;
@@ -262,75 +594,295 @@ bool segmented_arc::try_get_arc(arc & target_arc)
 	return arc::try_create_arc(arc_circle_ ,points_, original_shape_length_, resolution_mm_, target_arc);
 }
 
-bool segmented_arc::try_get_arc_(const circle& c, arc &target_arc)
+bool segmented_arc::try_get_arc_(const circle& c, arc &target_arc) const
 {
 	//int mid_point_index = ((points_.count() - 1) / 2) + 1;
 	//return arc::try_create_arc(c, points_[0], points_[mid_point_index], endpoint, original_shape_length_ + additional_distance, resolution_mm_, target_arc);
-	return arc::try_create_arc(c, points_, original_shape_length_, resolution_mm_, target_arc);
+	return (
+		arc::try_create_arc(c, points_, original_shape_length_, resolution_mm_, target_arc) &&
+		(!allow_helical_arcs_ || does_z_fit_points_()) &&
+		(num_arc_points_ == 0 || do_existing_arcs_fit_arc_(target_arc))
+	);
+}
+
+bool segmented_arc::do_segments_fit_circle_(const circle& c) const
+{
+	// Check the runs of lines between the existing arcs.  The arcs are checked by do_existing_arcs_fit_arc_.
+	int run_start = 0;
+	for (int index = 1; index <= points_.count(); index++)
+	{
+		if (index == points_.count() || points_[index].arc_length > 0)
+		{
+			if (index - 1 > run_start && window_.get_first_segment_off_circle(run_start, index - 1, c, resolution_mm_) != -1)
+				return false;
+			run_start = index;
+		}
+	}
+	return true;
 }
 
-std::string segmented_arc::get_shape_gcode_absolute(double e, double f)
+bool segmented_arc::do_existing_arcs_fit_arc_(const arc& a) const
+{
+	// No point of an existing arc is further from the new circle than the distance between the centers plus the
+	// difference of the radii, and going the same way around the same circle, it follows the same path.
+	bool is_clockwise = a.angle_radians < 0;
+	for (int index = 1; index < points_.count(); index++)
+	{
+		const point& p = points_[index];
+		if (p.arc_length == 0)
+			continue;
+		if (p.is_clockwise != is_clockwise)
+			return false;
+		const point& previous_point = points_[index - 1];
+		double radius = utilities::get_cartesian_distance(previous_point.x, previous_point.y, p.arc_center_x, p.arc_center_y);
+		double max_distance = utilities::get_cartesian_distance(p.arc_center_x, p.arc_center_y, a.center.x, a.center.y) + std::abs(radius - a.radius);
+		if (utilities::greater_than(max_distance, resolution_mm_))
+			return false;
+	}
+	return true;
+}
+
+void segmented_arc::get_shape_command_absolute(double e, double f, arc_command& command) const
 {
 	bool has_e = e_relative_ != 0;
-	return get_shape_gcode_(has_e, e, f);
+	get_shape_command_(has_e, e, f, command);
 }
-std::string segmented_arc::get_shape_gcode_relative(double f)
+void segmented_arc::get_shape_command_relative(double f, arc_command& command) const
 {
 	bool has_e = e_relative_ != 0;
-	return get_shape_gcode_(has_e, e_relative_, f);
+	get_shape_command_(has_e, e_relative_, f, command);
 }
 
-std::string segmented_arc::get_shape_gcode_(bool has_e, double e, double f) const
+void segmented_arc::get_shape_command_(bool has_e, double e, double f, arc_command& command) const
 {
-	
-	char buf[20];
-	std::string gcode;
 	arc c;
 	arc::try_create_arc(arc_circle_, points_, original_shape_length_, resolution_mm_, c);
-	
-	double i = c.center.x - c.start_point.x;
-	double j = c.center.y - c.start_point.y;
+
+	command.is_fixed_point = false;
+	command.is_relative = false;
+	command.is_clockwise = utilities::less_than(c.angle_radians, 0);
+	command.x = c.end_point.x;
+	command.y = c.end_point.y;
+	command.has_z = allow_helical_arcs_ && !utilities::is_equal(c.start_point.z, c.end_point.z);
+	command.z = c.end_point.z;
+	command.i = c.center.x - c.start_point.x;
+	command.j = c.center.y - c.start_point.y;
+	command.start_x = c.start_point.x;
+	command.start_y = c.start_point.y;
+	command.angle_radians = c.angle_radians;
+	command.has_e = has_e;
+	command.e = e;
+	command.f = f;
+}
+
+void segmented_arc::get_shape_command_fixed(long long x, long long y, long long z, bool has_e, long long e, double f, arc_command& command) const
+{
+	// Same as get_shape_command_, but the end point and e come from the exact fixed point values.  Only
+	// I and J are calculated in floating point.
+	arc c;
+	arc::try_create_arc(arc_circle_, points_, original_shape_length_, resolution_mm_, c);
+
+	command.is_fixed_point = true;
+	command.is_relative = false;
+	command.is_clockwise = utilities::less_than(c.angle_radians, 0);
+	command.x_fixed = x;
+	command.y_fixed = y;
+	command.has_z = allow_helical_arcs_ && !utilities::is_equal(c.start_point.z, c.end_point.z);
+	command.z_fixed = z;
+	command.i_fixed = utilities::to_fixed(c.center.x - c.start_point.x);
+	command.j_fixed = utilities::to_fixed(c.center.y - c.start_point.y);
+	command.start_x = c.start_point.x;
+	command.start_y = c.start_point.y;
+	command.angle_radians = c.angle_radians;
+	command.has_e = has_e;
+	command.e_fixed = e;
+	command.f = f;
+	command.f_fixed = utilities::to_fixed(f);
+}
+
+double segmented_arc::get_shape_gcode_words(const gcode_parameter_format& format, std::string& gcode) const
+{
+	arc c;
+	arc::try_create_arc(arc_circle_, points_, original_shape_length_, resolution_mm_, c);
+	gcode = utilities::less_than(c.angle_radians, 0) ? "G2" : "G3";
+	format.append_parameter(gcode, 'I', utilities::to_fixed(c.center.x - c.start_point.x), true, 3);
+	format.append_parameter(gcode, 'J', utilities::to_fixed(c.center.y - c.start_point.y), true, 3);
+	return original_shape_length_;
+}
+
+void arc_command::to_string(std::string& gcode) const
+{
 	// Here is where the performance part kicks in (these are expensive calls) that makes things a bit ugly.
-	// there are a few cases we need to take into consideration before choosing our sprintf string
-	// create the XYZ portion
-	
-	if (utilities::less_than(c.angle_radians, 0))
+	// Fixed point values are rounded instead of truncated.
+	char buf[32];
+	if (is_clockwise)
 	{
 		gcode = "G2";
 	}
 	else
 	{
 		gcode = "G3";
-	
 	}
-	// Add X, Y, I and J
+	// Add X, Y, Z, I and J.  Relative end points are written with every digit, so the rounding errors can't add up.
+	bool is_xyz_fixed_point = is_fixed_point || is_relative;
+	unsigned short xyz_precision = is_relative ? FIXED_POINT_DIGITS : 3;
 	gcode += " X";
-	gcode += utilities::to_string(c.end_point.x, 3, buf);
+	gcode += is_xyz_fixed_point ? utilities::fixed_to_string(x_fixed, xyz_precision, buf) : utilities::to_string(x, 3, buf);
 
 	gcode += " Y";
-	gcode += utilities::to_string(c.end_point.y, 3, buf);
+	gcode += is_xyz_fixed_point ? utilities::fixed_to_string(y_fixed, xyz_precision, buf) : utilities::to_string(y, 3, buf);
+
+	if (has_z)
+	{
+		gcode += " Z";
+		gcode += is_xyz_fixed_point ? utilities::fixed_to_string(z_fixed, xyz_precision, buf) : utilities::to_string(z, 3, buf);
+	}
 
 	gcode += " I";
-	gcode += utilities::to_string(i, 3, buf);
+	gcode += is_fixed_point ? utilities::fixed_to_string(i_fixed, 3, buf) : utilities::to_string(i, 3, buf);
 
 	gcode += " J";
-	gcode += utilities::to_string(j, 3, buf);
-	
+	gcode += is_fixed_point ? utilities::fixed_to_string(j_fixed, 3, buf) : utilities::to_string(j, 3, buf);
+
 	// Add E if it appears
 	if (has_e)
 	{
 		gcode += " E";
-		gcode += utilities::to_string(e, 5, buf);
+		gcode += is_fixed_point ? utilities::fixed_to_string(e_fixed, 5, buf) : utilities::to_string(e, 5, buf);
 	}
 
 	// Add F if it appears
 	if (utilities::greater_than_or_equal(f, 1))
 	{
 		gcode += " F";
-		gcode += utilities::to_string(f, 0, buf);
+		gcode += is_fixed_point ? utilities::fixed_to_string(f_fixed, 0, buf) : utilities::to_string(f, 0, buf);
 	}
+}
 
-	return gcode;
+void arc_command::to_minified_string(std::string& gcode, long long max_error_fixed, bool include_spaces) const
+{
+	gcode = is_clockwise ? "G2" : "G3";
+	// Relative end points are still written exactly, so the rounding errors can't add up.
+	unsigned short xyz_precision = is_relative ? FIXED_POINT_DIGITS : 3;
+	long long xyz_max_error = is_relative ? 0 : max_error_fixed;
+	bool is_xyz_fixed_point = is_fixed_point || is_relative;
+	append_parameter(gcode, 'X', is_xyz_fixed_point, x_fixed, x, xyz_precision, true, xyz_max_error, include_spaces);
+	append_parameter(gcode, 'Y', is_xyz_fixed_point, y_fixed, y, xyz_precision, true, xyz_max_error, include_spaces);
+	if (has_z)
+	{
+		append_parameter(gcode, 'Z', is_xyz_fixed_point, z_fixed, z, xyz_precision, true, xyz_max_error, include_spaces);
+	}
+	append_parameter(gcode, 'I', is_fixed_point, i_fixed, i, 3, true, max_error_fixed, include_spaces);
+	append_parameter(gcode, 'J', is_fixed_point, j_fixed, j, 3, true, max_error_fixed, include_spaces);
+	if (has_e)
+	{
+		append_parameter(gcode, 'E', is_fixed_point, e_fixed, e, 5, true, 0, include_spaces);
+	}
+	if (utilities::greater_than_or_equal(f, 1))
+	{
+		append_parameter(gcode, 'F', is_fixed_point, f_fixed, f, 0, true, 0, include_spaces);
+	}
+}
+
+bool arc_command::to_r_string(std::string& gcode, double max_path_error, double start_error, bool is_minified, long long max_error_fixed, bool include_spaces) const
+{
+	double sweep = std::abs(angle_radians);
+	if (
+		std::abs(sweep - PI_DOUBLE) < R_ARC_MIN_ANGLE_FROM_HALF_CIRCLE_RADIANS ||
+		sweep > 2.0 * PI_DOUBLE - R_ARC_MIN_ANGLE_FROM_HALF_CIRCLE_RADIANS
+	)
+	{
+		return false;
+	}
+	double center_i = is_fixed_point ? utilities::from_fixed(i_fixed) : i;
+	double center_j = is_fixed_point ? utilities::from_fixed(j_fixed) : j;
+	double radius = std::sqrt(center_i * center_i + center_j * center_j);
+	if (radius < R_ARC_MIN_RADIUS_MM)
+	{
+		return false;
+	}
+
+	gcode = is_clockwise ? "G2" : "G3";
+	unsigned short xyz_precision = is_relative ? FIXED_POINT_DIGITS : 3;
+	long long xyz_max_error = is_relative ? 0 : max_error_fixed;
+	bool is_xyz_fixed_point = is_fixed_point || is_relative;
+	double end_x = append_parameter(gcode, 'X', is_xyz_fixed_point, x_fixed, x, xyz_precision, is_minified, xyz_max_error, include_spaces);
+	double end_y = append_parameter(gcode, 'Y', is_xyz_fixed_point, y_fixed, y, xyz_precision, is_minified, xyz_max_error, include_spaces);
+	if (has_z)
+	{
+		append_parameter(gcode, 'Z', is_xyz_fixed_point, z_fixed, z, xyz_precision, is_minified, xyz_max_error, include_spaces);
+	}
+	// Arcs that turn more than half way around have a negative radius
+	double r = sweep > PI_DOUBLE ? -radius : radius;
+	r = append_parameter(gcode, 'R', is_fixed_point, utilities::to_fixed(r), r, 3, is_minified, max_error_fixed, include_spaces);
+	if (has_e)
+	{
+		append_parameter(gcode, 'E', is_fixed_point, e_fixed, e, 5, is_minified, 0, include_spaces);
+	}
+	if (utilities::greater_than_or_equal(f, 1))
+	{
+		append_parameter(gcode, 'F', is_fixed_point, f_fixed, f, 0, is_minified, 0, include_spaces);
+	}
 
+	// Draw both arcs the way the firmware does, from the real start point and from each corner of the square it may
+	// have been rounded to.  Relative end points move with the start.  The R center is on the perpendicular bisector
+	// of the chord, on the side given by the direction and the sign of R.  Both arcs go through the start and end
+	// points, so they are furthest apart near the middle.
+	static const double corners[5][2] = { { 0, 0 }, { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+	for (int index = 0; index < 5; index++)
+	{
+		double start_x_firmware = start_x + corners[index][0] * start_error;
+		double start_y_firmware = start_y + corners[index][1] * start_error;
+		double end_x_firmware = is_relative ? start_x_firmware + end_x : end_x;
+		double end_y_firmware = is_relative ? start_y_firmware + end_y : end_y;
+		double chord_x = end_x_firmware - start_x_firmware;
+		double chord_y = end_y_firmware - start_y_firmware;
+		double chord = std::sqrt(chord_x * chord_x + chord_y * chord_y);
+		if (utilities::is_zero(chord))
+		{
+			return false;
+		}
+		double h2 = (r - 0.5 * chord) * (r + 0.5 * chord);
+		double h = h2 > 0 ? std::sqrt(h2) : 0;
+		double side = is_clockwise != (r < 0) ? -1 : 1;
+		double r_center_x = start_x_firmware + 0.5 * chord_x - side * h * chord_y / chord;
+		double r_center_y = start_y_firmware + 0.5 * chord_y + side * h * chord_x / chord;
+		double r_mid_x, r_mid_y, ij_mid_x, ij_mid_y;
+		utilities::get_arc_midpoint(start_x_firmware, start_y_firmware, end_x_firmware, end_y_firmware, r_center_x, r_center_y, is_clockwise, r_mid_x, r_mid_y);
+		utilities::get_arc_midpoint(start_x_firmware, start_y_firmware, end_x_firmware, end_y_firmware, start_x_firmware + center_i, start_y_firmware + center_j, is_clockwise, ij_mid_x, ij_mid_y);
+		if (utilities::get_cartesian_distance(r_mid_x, r_mid_y, ij_mid_x, ij_mid_y) > max_path_error)
+		{
+			return false;
+		}
+	}
+	return true;
 }
 
+double arc_command::append_parameter(std::string& gcode, char name, bool is_fixed_point, long long value_fixed, double value, unsigned short precision, bool is_minified, long long max_error, bool include_spaces)
+{
+	char buf[32];
+	if (is_minified)
+	{
+		if (include_spaces)
+		{
+			gcode += ' ';
+		}
+		gcode += name;
+		utilities::fixed_to_minified_string(is_fixed_point ? value_fixed : utilities::to_fixed(value), precision, max_error, buf);
+	}
+	else
+	{
+		gcode += ' ';
+		gcode += name;
+		if (is_fixed_point)
+		{
+			utilities::fixed_to_string(value_fixed, precision, buf);
+		}
+		else
+		{
+			utilities::to_string(value, precision, buf);
+		}
+	}
+	gcode += buf;
+	return std::atof(buf);
+}
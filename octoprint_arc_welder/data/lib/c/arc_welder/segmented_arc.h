@@ -25,35 +25,184 @@
 
 #pragma once
 #include "segmented_shape.h"
+#include "point_window.h"
 #include <iomanip>
 #include <sstream>
+#include <vector>
 
 #define GCODE_CHAR_BUFFER_SIZE 100
 #define DEFAULT_MAX_RADIUS_MM 1000000.0 // 1km
+#define DEFAULT_USE_LEAST_SQUARES_FIT false
+// When using the least squares fit, skip the full point check if the worst case error is below this fraction of the resolution
+#define LEAST_SQUARES_SKIP_CHECK_RATIO 0.5
+#define DEFAULT_USE_LOOKAHEAD false
+#define DEFAULT_USE_SEGMENT_OPTIMIZER false
+#define DEFAULT_ALLOW_HELICAL_ARCS false
+// The segment optimizer plans at most this many points at once, since planning takes O(n^2) checks
+#define MAX_SEGMENT_OPTIMIZER_WINDOW DEFAULT_MAX_SEGMENTS
+
+// Arcs are only written with R (see arc_command::to_r_string) when they are at least this far from a half or full
+// circle, where the center the firmware calculates from R moves a lot when R is rounded, and when the radius is at
+// least this large.
+#define R_ARC_MIN_ANGLE_FROM_HALF_CIRCLE_RADIANS 0.1
+#define R_ARC_MIN_RADIUS_MM 1.0
+
+// A G2/G3 command that has not been converted to text yet.  When is_fixed_point is set, the _fixed values are used.
+struct arc_command
+{
+	arc_command()
+	{
+		is_clockwise = false;
+		is_fixed_point = false;
+		is_relative = false;
+		has_z = false;
+		has_e = false;
+		x = 0;
+		y = 0;
+		z = 0;
+		i = 0;
+		j = 0;
+		e = 0;
+		f = 0;
+		x_fixed = 0;
+		y_fixed = 0;
+		z_fixed = 0;
+		i_fixed = 0;
+		j_fixed = 0;
+		e_fixed = 0;
+		f_fixed = 0;
+		start_x = 0;
+		start_y = 0;
+		angle_radians = 0;
+	}
+	bool is_clockwise;
+	bool is_fixed_point;
+	// X, Y and Z are the distances moved (G91), and are always written from the exact fixed point values
+	bool is_relative;
+	// Set for helical arcs, which end at a different height than they start
+	bool has_z;
+	bool has_e;
+	double x;
+	double y;
+	double z;
+	double i;
+	double j;
+	double e;
+	double f;
+	long long x_fixed;
+	long long y_fixed;
+	long long z_fixed;
+	long long i_fixed;
+	long long j_fixed;
+	long long e_fixed;
+	long long f_fixed;
+	// Where the arc starts and how far it turns (negative when clockwise), used to check the R form
+	double start_x;
+	double start_y;
+	double angle_radians;
+	// Replaces the contents of gcode, so a reused string does not need to allocate.  F is only included if it is at least 1.
+	void to_string(std::string& gcode) const;
+	// The same command with as few characters as possible.  Absolute X, Y and Z, and I and J, are written with the fewest
+	// decimals that keep them within max_error_fixed, E and F are only trimmed, and the spaces are optional.
+	void to_minified_string(std::string& gcode, long long max_error_fixed, bool include_spaces) const;
+	// The same command with R instead of I and J, formatted like to_string or to_minified_string.  Returns false if the
+	// arc is too close to a half or full circle, or too small, or if the middle of the arc the firmware draws from R
+	// could be more than max_path_error from the middle of the one it draws from I and J.  The firmware starts where
+	// the previous command ended, which may have been written up to start_error from the real start point.
+	bool to_r_string(std::string& gcode, double max_path_error, double start_error, bool is_minified, long long max_error_fixed, bool include_spaces) const;
+private:
+	// Appends the parameter the way to_string or to_minified_string would, and returns the value that was written
+	static double append_parameter(std::string& gcode, char name, bool is_fixed_point, long long value_fixed, double value, unsigned short precision, bool is_minified, long long max_error, bool include_spaces);
+};
+
 class segmented_arc :
 	public segmented_shape
 {
 public:
 	segmented_arc();
-	segmented_arc(int min_segments = DEFAULT_MIN_SEGMENTS, int max_segments = DEFAULT_MAX_SEGMENTS, double resolution_mm = DEFAULT_RESOLUTION_MM, double max_radius_mm = DEFAULT_MAX_RADIUS_MM);
+	segmented_arc(int min_segments = DEFAULT_MIN_SEGMENTS, int max_segments = DEFAULT_MAX_SEGMENTS, double resolution_mm = DEFAULT_RESOLUTION_MM, double max_radius_mm = DEFAULT_MAX_RADIUS_MM, bool use_least_squares_fit = DEFAULT_USE_LEAST_SQUARES_FIT, bool use_lookahead = DEFAULT_USE_LOOKAHEAD, bool use_segment_optimizer = DEFAULT_USE_SEGMENT_OPTIMIZER, bool allow_helical_arcs = DEFAULT_ALLOW_HELICAL_ARCS);
 	virtual ~segmented_arc();
 	virtual bool try_add_point(point p, double e_relative);
-	std::string get_shape_gcode_absolute(double e, double f);
-	std::string get_shape_gcode_relative(double f);
+	void get_shape_command_absolute(double e, double f, arc_command& command) const;
+	void get_shape_command_relative(double f, arc_command& command) const;
+	void get_shape_command_fixed(long long x, long long y, long long z, bool has_e, long long e, double f, arc_command& command) const;
+	// A G2 or G3 with the center relative to the start, for an arc that replaces a run of lines in the shape
+	// competition.  These are always written with I and J.
+	virtual double get_shape_gcode_words(const gcode_parameter_format& format, std::string& gcode) const;
 	
 	virtual bool is_shape() const;
+	virtual void clear();
 	point pop_front(double e_relative);
 	point pop_back(double e_relative);
 	bool try_get_arc(arc & target_arc);
 	double get_max_radius() const;
+	bool get_use_least_squares_fit() const;
+	bool get_use_lookahead() const;
+	// Helical arcs may change Z, as long as it changes linearly along the arc
+	bool get_allow_helical_arcs() const;
+	// Validates the lookahead points that have not been checked yet, keeping the same arc the point by point checks
+	// would.  Returns the number of points that were rejected.  These are removed, and must be added again after the arc is closed.
+	int resolve_lookahead();
+	int get_num_lookahead_points() const;
+	// The number of times a circle was created and checked against the points
+	long long get_num_validations() const;
+	// With the segment optimizer, points are collected without being checked until the run of moves ends or the
+	// window is full.  plan_window then chooses where the arcs start and end so that the window needs as few commands
+	// as possible.
+	bool get_use_segment_optimizer() const;
+	void plan_window();
+	// The index of the last point of the planned arc starting at start_index, or -1 if a line starts there
+	int get_planned_arc_end(int start_index) const;
+	// Adds the points of a planned arc exactly as they were added when planning, so the arc command can be created
+	bool load_planned_arc(int start_index, int end_index);
 	// static gcode buffer
 
 private:
 	bool try_add_point_internal_(point p, double pd);
+	bool try_add_point_least_squares_(point p, double pd);
+	bool try_add_lookahead_point_(point p, double e_relative);
+	bool try_add_lookahead_points_();
+	void rebuild_fit_();
+	// Add and remove points from both points_ and window_
+	void push_point_(const point& p);
+	point pop_front_point_();
+	point pop_back_point_();
 	bool does_circle_fit_points_(circle& c) const;
-	bool try_get_arc_(const circle& c, arc& target_arc);
-	std::string get_shape_gcode_(bool has_e, double e, double f) const;
+	bool does_z_fit_points_() const;
+	bool do_segments_fit_circle_(const circle& c) const;
+	bool do_existing_arcs_fit_arc_(const arc& a) const;
+	bool try_get_arc_(const circle& c, arc& target_arc) const;
+	void get_shape_command_(bool has_e, double e, double f, arc_command& command) const;
 	circle arc_circle_;
 	double max_radius_mm_;
+	// The X and Y coordinates of points_, for the fit checks
+	point_window window_;
+	// Fit the circle to all of the points with running sums instead of through the first, middle and last points
+	bool use_least_squares_fit_;
+	least_squares_circle_fit fit_;
+	// Once the shape is found, points wait here and are checked when there are lookahead_step_ of them.  The step
+	// doubles every time the checks pass.  Every point is still checked, so the arcs and the number of checks are the
+	// same as point by point.
+	bool use_lookahead_;
+	array_list<point> lookahead_;
+	int lookahead_step_;
+	// Set when the points left in the lookahead come after the end of the arc
+	bool is_lookahead_rejected_;
+	long long num_validations_;
+	bool use_segment_optimizer_;
+	// Set while points are added to find or rebuild planned arcs, so that they are checked as usual
+	bool is_planning_;
+	array_list<point> window_points_;
+	// For each start point, the first and last end points that make a valid arc
+	std::vector<int> first_arc_ends_;
+	std::vector<int> last_arc_ends_;
+	// The fewest commands needed to reach each point, and the point the last of those commands starts from
+	std::vector<int> commands_to_point_;
+	std::vector<int> previous_points_;
+	std::vector<int> planned_arc_ends_;
+	bool allow_helical_arcs_;
+	// The number of points in points_ that end an existing arc.  Their paths are checked against the circle instead
+	// of their chords.
+	int num_arc_points_;
 };
 
@@ -0,0 +1,275 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "segmented_bezier.h"
+#include "utilities.h"
+#include <cmath>
+
+void bezier_curve::get_point(double t, double& x, double& y) const
+{
+	double mt = 1.0 - t;
+	double b0 = mt * mt * mt;
+	double b1 = 3.0 * mt * mt * t;
+	double b2 = 3.0 * mt * t * t;
+	double b3 = t * t * t;
+	x = b0 * start_x + b1 * control_1_x + b2 * control_2_x + b3 * end_x;
+	y = b0 * start_y + b1 * control_1_y + b2 * control_2_y + b3 * end_y;
+}
+
+segmented_bezier::segmented_bezier(int min_segments, int max_segments, double resolution_mm) : segmented_shape(min_segments, max_segments, resolution_mm), parameters_(max_segments)
+{
+}
+
+segmented_bezier::~segmented_bezier()
+{
+}
+
+void segmented_bezier::clear()
+{
+	segmented_shape::clear();
+	parameters_.clear();
+	curve_ = bezier_curve();
+}
+
+bool segmented_bezier::try_add_point(point p, double e_relative)
+{
+	int num_points = points_.count();
+	if (num_points == 0)
+	{
+		points_.push_back(p);
+		return true;
+	}
+	if (num_points >= get_max_segments())
+	{
+		return false;
+	}
+	const point& previous = points_[num_points - 1];
+	double distance = utilities::get_cartesian_distance(previous.x, previous.y, p.x, p.y);
+	// Every line must extrude, since the extrusion places the points on the curve
+	if (utilities::is_zero(distance) || e_relative <= 0)
+	{
+		return false;
+	}
+	p.e_relative = e_relative;
+	points_.push_back(p);
+	original_shape_length_ += distance;
+	e_relative_ += e_relative;
+	// The direction of the path at each end comes from the first and last three points
+	if (points_.count() < BEZIER_MIN_POINTS)
+	{
+		return true;
+	}
+	bezier_curve curve;
+	if (!try_fit_curve_(curve))
+	{
+		points_.pop_back();
+		original_shape_length_ -= distance;
+		e_relative_ -= e_relative;
+		return false;
+	}
+	curve_ = curve;
+	set_is_shape(points_.count() > get_min_segments() && !is_straight_());
+	return true;
+}
+
+bool segmented_bezier::is_shape() const
+{
+	return is_shape_;
+}
+
+const bezier_curve& segmented_bezier::get_curve() const
+{
+	return curve_;
+}
+
+// The control points are relative to the start (I J) and the end (P Q) of the curve, and can be rounded like any other
+// coordinate.  Without minification they are computed values, so they are rounded like arc I and J.
+double segmented_bezier::get_shape_gcode_words(const gcode_parameter_format& format, std::string& gcode) const
+{
+	gcode = "G5";
+	format.append_parameter(gcode, 'I', utilities::to_fixed(curve_.control_1_x - curve_.start_x), true, BEZIER_CONTROL_POINT_PRECISION);
+	format.append_parameter(gcode, 'J', utilities::to_fixed(curve_.control_1_y - curve_.start_y), true, BEZIER_CONTROL_POINT_PRECISION);
+	format.append_parameter(gcode, 'P', utilities::to_fixed(curve_.control_2_x - curve_.end_x), true, BEZIER_CONTROL_POINT_PRECISION);
+	format.append_parameter(gcode, 'Q', utilities::to_fixed(curve_.control_2_y - curve_.end_y), true, BEZIER_CONTROL_POINT_PRECISION);
+	return original_shape_length_;
+}
+
+// The firmware spreads the extrusion evenly over the curve's parameter, so each point is given the parameter at which
+// the firmware will have extruded as much as the lines had by that point.  The curve then has to pass close to the
+// point at that parameter, which covers both the path and the extrusion.
+bool segmented_bezier::try_fit_curve_(bezier_curve& curve)
+{
+	int num_points = points_.count();
+	parameters_.clear();
+	parameters_.push_back(0);
+	double e_total = 0;
+	for (int index = 1; index < num_points; index++)
+	{
+		e_total += points_[index].e_relative;
+		parameters_.push_back(e_total / e_relative_);
+	}
+	parameters_[num_points - 1] = 1.0;
+	return fit_control_points_(curve) && does_curve_fit_points_(curve);
+}
+
+// The direction of the path at the first of three points, from the parabola through them
+bool segmented_bezier::get_end_tangent(const point& a, const point& b, const point& c, double& x, double& y)
+{
+	double h1 = utilities::get_cartesian_distance(a.x, a.y, b.x, b.y);
+	double h2 = utilities::get_cartesian_distance(b.x, b.y, c.x, c.y);
+	double wa = -(2.0 * h1 + h2) / (h1 * (h1 + h2));
+	double wb = (h1 + h2) / (h1 * h2);
+	double wc = -h1 / (h2 * (h1 + h2));
+	x = wa * a.x + wb * b.x + wc * c.x;
+	y = wa * a.y + wb * b.y + wc * c.y;
+	double length = std::sqrt(x * x + y * y);
+	if (utilities::is_zero(length))
+	{
+		return false;
+	}
+	x /= length;
+	y /= length;
+	return true;
+}
+
+// The control points are on the directions of the path at each end, and only their distances from the ends are fit, so
+// the curve leaves and joins the path in the same direction as the lines (see Schneider, Graphics Gems 1990).
+bool segmented_bezier::fit_control_points_(bezier_curve& curve) const
+{
+	int num_points = points_.count();
+	const point& start = points_[0];
+	const point& end = points_[num_points - 1];
+	double t1_x, t1_y, t2_x, t2_y;
+	if (
+		!get_end_tangent(start, points_[1], points_[2], t1_x, t1_y) ||
+		!get_end_tangent(end, points_[num_points - 2], points_[num_points - 3], t2_x, t2_y)
+	)
+	{
+		return false;
+	}
+	double c11 = 0, c12 = 0, c22 = 0, x1 = 0, x2 = 0;
+	for (int index = 1; index < num_points - 1; index++)
+	{
+		double t = parameters_[index];
+		double mt = 1.0 - t;
+		double b0 = mt * mt * mt;
+		double b1 = 3.0 * mt * mt * t;
+		double b2 = 3.0 * mt * t * t;
+		double b3 = t * t * t;
+		double a1_x = t1_x * b1;
+		double a1_y = t1_y * b1;
+		double a2_x = t2_x * b2;
+		double a2_y = t2_y * b2;
+		c11 += a1_x * a1_x + a1_y * a1_y;
+		c12 += a1_x * a2_x + a1_y * a2_y;
+		c22 += a2_x * a2_x + a2_y * a2_y;
+		// What is left of the point after the part of it that comes from the end points
+		double remainder_x = points_[index].x - (b0 + b1) * start.x - (b2 + b3) * end.x;
+		double remainder_y = points_[index].y - (b0 + b1) * start.y - (b2 + b3) * end.y;
+		x1 += a1_x * remainder_x + a1_y * remainder_y;
+		x2 += a2_x * remainder_x + a2_y * remainder_y;
+	}
+	double determinant = c11 * c22 - c12 * c12;
+	if (std::abs(determinant) < 1.0e-12)
+	{
+		return false;
+	}
+	double alpha_1 = (x1 * c22 - x2 * c12) / determinant;
+	double alpha_2 = (c11 * x2 - c12 * x1) / determinant;
+	// A control point behind its end would turn the curve back on itself
+	if (alpha_1 <= 0 || alpha_2 <= 0)
+	{
+		return false;
+	}
+	curve.start_x = start.x;
+	curve.start_y = start.y;
+	curve.control_1_x = start.x + t1_x * alpha_1;
+	curve.control_1_y = start.y + t1_y * alpha_1;
+	curve.control_2_x = end.x + t2_x * alpha_2;
+	curve.control_2_y = end.y + t2_y * alpha_2;
+	curve.end_x = end.x;
+	curve.end_y = end.y;
+	return true;
+}
+
+// Every point must be within the resolution of the curve, and as for arcs, the length of the curve must be within the
+// resolution of the length of the lines, so that it can't wander between the points.
+bool segmented_bezier::does_curve_fit_points_(const bezier_curve& curve) const
+{
+	int num_points = points_.count();
+	double previous_t = 0;
+	double previous_x = curve.start_x;
+	double previous_y = curve.start_y;
+	double curve_length = 0;
+	for (int index = 1; index < num_points; index++)
+	{
+		const point& previous = points_[index - 1];
+		const point& current = points_[index];
+		double t = parameters_[index];
+		double x, y;
+		curve.get_point(t, x, y);
+		if (utilities::get_cartesian_distance(x, y, current.x, current.y) > resolution_mm_)
+		{
+			return false;
+		}
+		// The curve bulges away from each line the most around the middle of its span, and may do so by the resolution
+		double mid_x, mid_y;
+		curve.get_point((previous_t + t) / 2.0, mid_x, mid_y);
+		if (distance_from_segment(segment(previous, current), point(mid_x, mid_y, current.z, 0)) > resolution_mm_)
+		{
+			return false;
+		}
+		curve_length += utilities::get_cartesian_distance(previous_x, previous_y, mid_x, mid_y);
+		curve_length += utilities::get_cartesian_distance(mid_x, mid_y, x, y);
+		previous_t = t;
+		previous_x = x;
+		previous_y = y;
+	}
+	return utilities::is_equal(curve_length, original_shape_length_, resolution_mm_);
+}
+
+// Straight runs are left for the line simplification, which writes them as a shorter G1
+bool segmented_bezier::is_straight_() const
+{
+	int num_points = points_.count();
+	const point& start = points_[0];
+	const point& end = points_[num_points - 1];
+	double line_x = end.x - start.x;
+	double line_y = end.y - start.y;
+	double line_length = utilities::get_cartesian_distance(start.x, start.y, end.x, end.y);
+	if (utilities::is_zero(line_length))
+	{
+		return false;
+	}
+	for (int index = 1; index < num_points - 1; index++)
+	{
+		const point& current = points_[index];
+		if (std::abs((current.x - start.x) * line_y - (current.y - start.y) * line_x) / line_length > resolution_mm_)
+		{
+			return false;
+		}
+	}
+	return true;
+}
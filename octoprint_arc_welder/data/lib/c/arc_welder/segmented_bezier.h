@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "segmented_shape.h"
+
+#define DEFAULT_ALLOW_BEZIER_CURVES false
+// The direction of the path at each end is found from the three points at that end
+#define BEZIER_MIN_POINTS 3
+// The decimals written for the control points when the gcode isn't minified, the same as for arc I and J
+#define BEZIER_CONTROL_POINT_PRECISION 3
+
+// The control points of a cubic Bezier curve.  The curve leaves the start heading towards the first control point, and
+// reaches the end coming from the second control point.
+struct bezier_curve
+{
+	bezier_curve()
+	{
+		start_x = 0;
+		start_y = 0;
+		control_1_x = 0;
+		control_1_y = 0;
+		control_2_x = 0;
+		control_2_y = 0;
+		end_x = 0;
+		end_y = 0;
+	}
+	double start_x;
+	double start_y;
+	double control_1_x;
+	double control_1_y;
+	double control_2_x;
+	double control_2_y;
+	double end_x;
+	double end_y;
+	void get_point(double t, double& x, double& y) const;
+};
+
+// A run of lines that can be replaced by one cubic Bezier curve (G5), for curves that are not circular enough to be
+// welded into arcs.  The curve starts and ends exactly where the run does, in the direction the path has there, and
+// every point must be within the resolution of the curve.
+//
+// The firmware spreads the extrusion evenly over the curve's parameter (t) rather than its length, so only curves that
+// are traced at a nearly even speed can replace the lines.
+class segmented_bezier :
+	public segmented_shape
+{
+public:
+	segmented_bezier(int min_segments = DEFAULT_MIN_SEGMENTS, int max_segments = DEFAULT_MAX_SEGMENTS, double resolution_mm = DEFAULT_RESOLUTION_MM);
+	virtual ~segmented_bezier();
+	// The first point is the start of the run, and is added with no e_relative.
+	virtual bool try_add_point(point p, double e_relative);
+	virtual void clear();
+	// True once the run has min_segments lines and does not fit a single straight line
+	virtual bool is_shape() const;
+	// The curve that fits every point that was added
+	const bezier_curve& get_curve() const;
+	// A G5 with the control points of the curve
+	virtual double get_shape_gcode_words(const gcode_parameter_format& format, std::string& gcode) const;
+private:
+	bool try_fit_curve_(bezier_curve& curve);
+	bool fit_control_points_(bezier_curve& curve) const;
+	static bool get_end_tangent(const point& end, const point& next, const point& after_next, double& x, double& y);
+	bool is_straight_() const;
+	bool does_curve_fit_points_(const bezier_curve& curve) const;
+	bezier_curve curve_;
+	// The curve parameter of each point, from 0 at the start to 1 at the end, in proportion to the extrusion
+	array_list<double> parameters_;
+};
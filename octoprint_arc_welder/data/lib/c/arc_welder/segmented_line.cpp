@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "segmented_line.h"
+#include "utilities.h"
+#include <cmath>
+
+segmented_line::segmented_line(int max_segments, double resolution_mm) : segmented_shape(DEFAULT_MIN_SEGMENTS, max_segments, resolution_mm)
+{
+}
+
+segmented_line::~segmented_line()
+{
+}
+
+bool segmented_line::try_add_point(point p, double e_relative)
+{
+	int num_points = points_.count();
+	if (num_points == 0)
+	{
+		points_.push_back(p);
+		return true;
+	}
+	if (num_points >= get_max_segments())
+	{
+		return false;
+	}
+	const point& previous = points_[num_points - 1];
+	double distance = utilities::get_cartesian_distance(previous.x, previous.y, p.x, p.y);
+	if (utilities::is_zero(distance))
+	{
+		return false;
+	}
+	p.e_relative = e_relative;
+	if (num_points > 1 && !does_line_fit_points_(p, e_relative))
+	{
+		return false;
+	}
+	points_.push_back(p);
+	original_shape_length_ += distance;
+	e_relative_ += e_relative;
+	set_is_shape(points_.count() > 2);
+	return true;
+}
+
+bool segmented_line::is_shape() const
+{
+	return is_shape_;
+}
+
+double segmented_line::get_line_length() const
+{
+	int num_points = points_.count();
+	if (num_points < 2)
+	{
+		return 0;
+	}
+	const point& start = points_[0];
+	const point& end = points_[num_points - 1];
+	return utilities::get_cartesian_distance(start.x, start.y, end.x, end.y);
+}
+
+double segmented_line::get_shape_gcode_words(const gcode_parameter_format& /*format*/, std::string& gcode) const
+{
+	gcode = "G1";
+	return get_line_length();
+}
+
+bool segmented_line::does_line_fit_points_(const point& p, double e_relative) const
+{
+	const point& start = points_[0];
+	double line_x = p.x - start.x;
+	double line_y = p.y - start.y;
+	double line_length = utilities::get_cartesian_distance(start.x, start.y, p.x, p.y);
+	if (utilities::is_zero(line_length))
+	{
+		return false;
+	}
+	// Every point must be within the resolution of the line, and must be further along it than the point before, so
+	// that the line never doubles back on itself.
+	double previous_distance_along = 0;
+	for (int index = 1; index < points_.count(); index++)
+	{
+		const point& current = points_[index];
+		double distance_along = ((current.x - start.x) * line_x + (current.y - start.y) * line_y) / line_length;
+		if (distance_along <= previous_distance_along || distance_along >= line_length)
+		{
+			return false;
+		}
+		double distance_from_line = std::abs((current.x - start.x) * line_y - (current.y - start.y) * line_x) / line_length;
+		if (distance_from_line > resolution_mm_)
+		{
+			return false;
+		}
+		previous_distance_along = distance_along;
+	}
+
+	// The line gets all of the extrusion, so the extrusion per mm of every original line must be close to that of the
+	// new one, else the width of the extrusion would change.
+	double e_rate = (e_relative_ + e_relative) / line_length;
+	double max_e_rate_change = std::abs(e_rate) * LINE_SIMPLIFICATION_MAX_E_RATE_CHANGE;
+	for (int index = 1; index <= points_.count(); index++)
+	{
+		const point& previous = points_[index - 1];
+		const point& current = index < points_.count() ? points_[index] : p;
+		double segment_length = utilities::get_cartesian_distance(previous.x, previous.y, current.x, current.y);
+		if (std::abs(current.e_relative / segment_length - e_rate) > max_e_rate_change)
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address: 
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#include "segmented_shape.h"
+
+#define DEFAULT_USE_LINE_SIMPLIFICATION false
+// How much the extrusion per mm of any of the original lines may differ from the extrusion per mm of the line that
+// replaces them, as a fraction of the latter.
+#define LINE_SIMPLIFICATION_MAX_E_RATE_CHANGE 0.05
+
+// A run of nearly collinear lines that can be replaced by a single line from the first point to the last.  This is a
+// streaming Douglas-Peucker simplification:  points are added until one of them would put an earlier point outside
+// of the resolution, and the run never holds more than max_segments points.
+class segmented_line :
+	public segmented_shape
+{
+public:
+	segmented_line(int max_segments = DEFAULT_MAX_SEGMENTS, double resolution_mm = DEFAULT_RESOLUTION_MM);
+	virtual ~segmented_line();
+	// The first point is the start of the run, and is added with no e_relative.
+	virtual bool try_add_point(point p, double e_relative);
+	// True once there are at least two lines to replace
+	virtual bool is_shape() const;
+	// The length of the line that replaces the run
+	double get_line_length() const;
+	// A G1 to the end of the run
+	virtual double get_shape_gcode_words(const gcode_parameter_format& format, std::string& gcode) const;
+private:
+	bool does_line_fit_points_(const point& p, double e_relative) const;
+};
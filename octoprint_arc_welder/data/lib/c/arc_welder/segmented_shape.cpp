@@ -72,6 +72,13 @@ vector operator *(vector lhs, const double& rhs) {
 #pragma endregion Operators for Vector and Point
 
 #pragma region Point Functions
+double point::get_path_length(const point& previous, const point& p)
+{
+	if (p.arc_length > 0)
+		return p.arc_length;
+	return utilities::get_cartesian_distance(previous.x, previous.y, p.x, p.y);
+}
+
 point point::get_midpoint(point p1, point p2)
 {
 	double x = (p1.x + p2.x) / 2.0;
@@ -421,4 +428,27 @@ std::string segmented_shape::get_shape_gcode_absolute(double e_abs_start)
 std::string segmented_shape::get_shape_gcode_relative()
 {
 	throw std::exception();
+}
+
+double segmented_shape::get_shape_gcode_words(const gcode_parameter_format& /*format*/, std::string& /*gcode*/) const
+{
+	throw std::exception();
+}
+
+void gcode_parameter_format::append_parameter(std::string& gcode, char name, long long value, bool can_round, unsigned short precision) const
+{
+	char buf[32];
+	if (!is_minified)
+	{
+		gcode += ' ';
+		gcode += name;
+		gcode += utilities::fixed_to_string(value, precision, buf);
+		return;
+	}
+	if (include_spaces)
+	{
+		gcode += ' ';
+	}
+	gcode += name;
+	gcode += utilities::fixed_to_minified_string(value, FIXED_POINT_DIGITS, can_round ? max_error_fixed : 0, buf);
 }
\ No newline at end of file
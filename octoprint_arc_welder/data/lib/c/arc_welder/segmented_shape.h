@@ -53,18 +53,34 @@ public:
 		y = 0;
 		z = 0;
 		e_relative = 0;
+		arc_length = 0;
+		arc_center_x = 0;
+		arc_center_y = 0;
+		is_clockwise = false;
 	}
 	point(double p_x, double p_y, double p_z, double p_e_relative) {
 		x = p_x;
 		y = p_y;
 		z = p_z;
 		e_relative = p_e_relative;
+		arc_length = 0;
+		arc_center_x = 0;
+		arc_center_y = 0;
+		is_clockwise = false;
 	}
 	double x;
 	double y;
 	double z;
 	double e_relative;
+	// Set when the point is the end of an existing arc (G2/G3) that starts at the previous point.  The arc length is
+	// 0 for lines.
+	double arc_length;
+	double arc_center_x;
+	double arc_center_y;
+	bool is_clockwise;
 	static point get_midpoint(point p1, point p2);
+	// The length of the path from the previous point to p, along the arc if p ends one
+	static double get_path_length(const point& previous, const point& p);
 };
 
 struct segment
@@ -168,6 +184,23 @@ struct arc : circle
 };
 double distance_from_segment(segment s, point p);
 
+// How the parameters of a command are written, which depends on the minification settings (see arc_welder_args)
+struct gcode_parameter_format
+{
+	gcode_parameter_format()
+	{
+		is_minified = false;
+		include_spaces = true;
+		max_error_fixed = 0;
+	}
+	bool is_minified;
+	bool include_spaces;
+	// How far a minified coordinate may be rounded
+	long long max_error_fixed;
+	// Without minification the value is written with the given number of decimals
+	void append_parameter(std::string& gcode, char name, long long value, bool can_round, unsigned short precision = FIXED_POINT_DIGITS) const;
+};
+
 #define DEFAULT_MIN_SEGMENTS 3
 #define DEFAULT_MAX_SEGMENTS 50
 #define DEFAULT_RESOLUTION_MM 0.05
@@ -193,6 +226,9 @@ public:
 	virtual bool try_add_point(point p, double e_relative);
 	virtual std::string get_shape_gcode_absolute(double e_abs_start);
 	virtual std::string get_shape_gcode_relative();
+	// Replaces gcode with the command that draws the shape and the parameters that only this shape has.  The end
+	// point, E and F are the same for every shape and are appended by the caller.  Returns the length of the path.
+	virtual double get_shape_gcode_words(const gcode_parameter_format& format, std::string& gcode) const;
 	bool is_extruding();
 protected:
 	array_list<point> points_;
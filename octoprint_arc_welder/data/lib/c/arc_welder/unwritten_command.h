@@ -25,37 +25,131 @@
 #pragma once
 #include "parsed_command.h"
 #include "position.h"
+#include "segmented_arc.h"
+// Flags for the X, Y, Z, E and F parameters of a command
+#define PARAMETER_NONE 0
+#define PARAMETER_X 1
+#define PARAMETER_Y 2
+#define PARAMETER_Z 4
+#define PARAMETER_E 8
+#define PARAMETER_F 16
+// Added to the redundant parameters when the whole command can be removed
+#define REDUNDANT_COMMAND 32
 struct unwritten_command
 {
 	unwritten_command() {
+		is_arc = false;
 		is_extruder_relative = false;
 		e_relative = 0;
+		e_relative_fixed = 0;
 		offset_e = 0;
 		extrusion_length = 0;
+		clear_line_();
+		redundant_parameters = PARAMETER_NONE;
+		absolute_parameters = PARAMETER_NONE;
 	}
 	unwritten_command(parsed_command &cmd, bool is_relative, double command_length) {
+		set(cmd, is_relative, command_length);
+	}
+	unwritten_command(parsed_command &cmd, position* p, double command_length) {
+		set(cmd, p, command_length);
+	}
+	// The set functions copy into the existing command, so an unwritten command that is reused
+	// (see array_list::push_back()) doesn't need to allocate once its strings are large enough.
+	void set(parsed_command &cmd, bool is_relative, double command_length) {
+		is_arc = false;
 		is_extruder_relative = is_relative;
+		e_relative = 0;
+		e_relative_fixed = 0;
+		offset_e = 0;
 		command = cmd;
 		extrusion_length = command_length;
+		clear_line_();
+		redundant_parameters = PARAMETER_NONE;
+		absolute_parameters = PARAMETER_NONE;
 	}
-	unwritten_command(position* p, double command_length) {
-	  
+	void set(parsed_command &cmd, position* p, double command_length) {
+		is_arc = false;
 		e_relative = p->get_current_extruder().e_relative;
+		e_relative_fixed = p->get_current_extruder().e_relative_fixed;
 		offset_e = p->get_current_extruder().get_offset_e();
 		is_extruder_relative = p->is_extruder_relative;
-		command = p->command;
+		command = cmd;
+		extrusion_length = command_length;
+		clear_line_();
+		redundant_parameters = PARAMETER_NONE;
+		absolute_parameters = PARAMETER_NONE;
+	}
+	// Marks a G1 extrusion that may be merged with the lines around it (see segmented_line), and records where it
+	// starts and ends in gcode coordinates.
+	void set_line(const position* p_start, const position* p_end) {
+		is_line = true;
+		start_x = p_start->get_gcode_x();
+		start_y = p_start->get_gcode_y();
+		end_x = p_end->get_gcode_x();
+		end_y = p_end->get_gcode_y();
+		end_x_fixed = p_end->get_gcode_x_fixed();
+		end_y_fixed = p_end->get_gcode_y_fixed();
+		offset_e_fixed = p_end->get_current_extruder().get_offset_e_fixed();
+		f = p_end->f;
+		feature_type_tag = p_end->feature_type_tag;
+	}
+	// Generated arcs are kept as an arc_command, and are only converted to text when written.  The caller
+	// fills in the arc.
+	void set_arc(const std::string& comment, bool is_relative, double command_length) {
+		is_arc = true;
+		is_extruder_relative = is_relative;
+		e_relative = 0;
+		e_relative_fixed = 0;
+		offset_e = 0;
+		command.clear();
+		command.comment = comment;
 		extrusion_length = command_length;
+		clear_line_();
+		redundant_parameters = PARAMETER_NONE;
+		absolute_parameters = PARAMETER_NONE;
 	}
+	// If true, the gcode is in arc and command only holds the comment
+	bool is_arc;
+	arc_command arc;
 	bool is_extruder_relative;
 	double e_relative;
+	long long e_relative_fixed;
 	double offset_e;
 	double extrusion_length;
 	parsed_command command;
+	// The parameters that can be removed without changing what the printer does, and the parameters that set an
+	// absolute position or feedrate.  Only set when redundant commands are removed.
+	int redundant_parameters;
+	int absolute_parameters;
+	// Only set for lines (see set_line)
+	bool is_line;
+	double start_x;
+	double start_y;
+	double end_x;
+	double end_y;
+	long long end_x_fixed;
+	long long end_y_fixed;
+	long long offset_e_fixed;
+	double f;
+	int feature_type_tag;
 
 	std::string to_string(bool rewrite, std::string additional_comment)
 	{
 		command.comment.append(additional_comment);
 
+		if (is_arc)
+		{
+			std::string gcode;
+			arc.to_string(gcode);
+			if (command.comment.length() > 0)
+			{
+				gcode += ";";
+				gcode += command.comment;
+			}
+			return gcode;
+		}
+
 		if (rewrite)
 		{
 			return command.rewrite_gcode_string();
@@ -63,5 +157,17 @@ struct unwritten_command
 
 		return command.to_string();
 	}
+private:
+	void clear_line_() {
+		is_line = false;
+		start_x = 0;
+		start_y = 0;
+		end_x = 0;
+		end_y = 0;
+		end_x_fixed = 0;
+		end_y_fixed = 0;
+		offset_e_fixed = 0;
+		f = 0;
+		feature_type_tag = 0;
+	}
 };
-
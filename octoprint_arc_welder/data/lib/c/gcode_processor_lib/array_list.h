@@ -64,38 +64,39 @@ public:
 	
 	void push_front(T object)
 	{
-		if (count_ == max_size_)
-		{
-			if (auto_grow_)
-			{
-				resize(max_size_ * 2);
-			}
-			else {
-				throw std::exception();
-			}
-		}
+		grow_if_full_();
 		front_index_ = (front_index_ - 1 + max_size_) % max_size_;
 		count_++;
 		items_[front_index_] = object;
 	}
+
+	// Adds an item to the front of the list and returns it so it can be filled in place, like push_back().
+	T& push_front()
+	{
+		grow_if_full_();
+		front_index_ = (front_index_ - 1 + max_size_) % max_size_;
+		count_++;
+		return items_[front_index_];
+	}
 	
 	void push_back(T object)
 	{
-		if (count_ == max_size_)
-		{
-			if (auto_grow_)
-			{
-				resize(max_size_ * 2);
-			}
-			else {
-				throw std::exception();
-			}
-		}
+		grow_if_full_();
 		items_[(front_index_ + count_ + max_size_) % max_size_] = object;
 		count_++;
 	}
+
+	// Adds an item to the back of the list and returns it so it can be filled in place.  The item is
+	// whatever was last stored in the slot, which lets it reuse its own buffers.
+	T& push_back()
+	{
+		grow_if_full_();
+		count_++;
+		return items_[(front_index_ + count_ - 1 + max_size_) % max_size_];
+	}
 	
-	T pop_front()
+	// The returned reference is only valid until the next push.
+	T& pop_front()
 	{
 		if (count_ == 0)
 		{
@@ -108,14 +109,15 @@ public:
 		return items_[prev_start];
 	}
 
-	T pop_back()
+	// The returned reference is only valid until the next push.
+	T& pop_back()
 	{
 		if (count_ == 0)
 		{
 			throw std::exception();
 		}
-
-		return items_[--count_];
+		count_--;
+		return items_[(front_index_ + count_ + max_size_) % max_size_];
 	}
 	
 	T& operator[] (const int index) const
@@ -160,6 +162,22 @@ public:
 	}
 
 protected:
+	// Doubles the capacity when the list is full (or throws if it can't grow).  Never resizes to 0, since there
+	// would be no slot for the item being added.
+	void grow_if_full_()
+	{
+		if (count_ == max_size_)
+		{
+			if (auto_grow_)
+			{
+				resize(max_size_ > 0 ? max_size_ * 2 : 1);
+			}
+			else {
+				throw std::exception();
+			}
+		}
+	}
+
 	T* items_;
 	int  max_size_;
 	int  front_index_;
@@ -45,9 +45,20 @@ extruder::extruder()
 	is_deretracting_start = false;
 	is_deretracting = false;
 	is_deretracted = false;
+	x_firmware_offset_fixed = 0;
+	y_firmware_offset_fixed = 0;
+	z_firmware_offset_fixed = 0;
+	e_fixed = 0;
+	e_offset_fixed = 0;
+	e_relative_fixed = 0;
 }
 
 double extruder::get_offset_e() const
 {
 	return e - e_offset;
 }
+
+long long extruder::get_offset_e_fixed() const
+{
+	return e_fixed - e_offset_fixed;
+}
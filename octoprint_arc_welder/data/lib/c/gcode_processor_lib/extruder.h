@@ -44,6 +44,14 @@ struct extruder
 	bool is_deretracting_start;
 	bool is_deretracting;
 	bool is_deretracted;
+	// Fixed point copies of the firmware offsets and e values (see FIXED_POINT_SCALE)
+	long long x_firmware_offset_fixed;
+	long long y_firmware_offset_fixed;
+	long long z_firmware_offset_fixed;
+	long long e_fixed;
+	long long e_offset_fixed;
+	long long e_relative_fixed;
 	double get_offset_e() const;
+	long long get_offset_e_fixed() const;
 };
 
@@ -20,11 +20,68 @@
 // FormerLurker@pm.me
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #include "gcode_comment_processor.h"
+#include <cstring>
 
 gcode_comment_processor::gcode_comment_processor()
 {
 	current_section_ = section_type_no_section;
 	processing_type_ = comment_process_type_unknown;
+	slicer_detection_comments_remaining_ = SLICER_DETECTION_MAX_COMMENTS;
+	build_comment_tag_table();
+}
+
+void gcode_comment_processor::build_comment_tag_table()
+{
+	min_comment_tag_length_ = std::string::npos;
+	max_comment_tag_length_ = 0;
+	for (int index = 0; index < COMMENT_TAG_TABLE_SIZE; index++)
+	{
+		comment_tag_table_[index] = -1;
+	}
+	for (int index = 0; index < NUM_SLIC3R_PE_COMMENT_TAGS; index++)
+	{
+		std::string::size_type length = strlen(slic3r_pe_comment_tags[index].comment);
+		if (length < min_comment_tag_length_)
+			min_comment_tag_length_ = length;
+		if (length > max_comment_tag_length_)
+			max_comment_tag_length_ = length;
+		unsigned int slot = get_comment_hash(slic3r_pe_comment_tags[index].comment, length) & (COMMENT_TAG_TABLE_SIZE - 1);
+		while (comment_tag_table_[slot] != -1)
+		{
+			slot = (slot + 1) & (COMMENT_TAG_TABLE_SIZE - 1);
+		}
+		comment_tag_table_[slot] = index;
+	}
+}
+
+unsigned int gcode_comment_processor::get_comment_hash(const char* comment, std::string::size_type length)
+{
+	// FNV-1a
+	unsigned int hash = 2166136261u;
+	for (std::string::size_type index = 0; index < length; index++)
+	{
+		hash ^= static_cast<unsigned char>(comment[index]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void gcode_comment_processor::detect_slicer(const std::string& comment)
+{
+	slicer_detection_comments_remaining_--;
+	if (comment.find("PrusaSlicer") != std::string::npos || comment.find("Slic3r") != std::string::npos || comment.find("SuperSlicer") != std::string::npos)
+	{
+		if (comment.find("generated by") != std::string::npos)
+			processing_type_ = comment_process_type_slic3r_pe;
+	}
+	else if (comment.find("Cura_SteamEngine") != std::string::npos)
+	{
+		processing_type_ = comment_process_type_cura;
+	}
+	else if (comment.find("Simplify3D") != std::string::npos)
+	{
+		processing_type_ = comment_process_type_simplify_3d;
+	}
 }
 
 gcode_comment_processor::~gcode_comment_processor()
@@ -36,7 +93,7 @@ comment_process_type gcode_comment_processor::get_comment_process_type()
 	return processing_type_;
 }
 
-void gcode_comment_processor::update(position& pos)
+void gcode_comment_processor::update(position& pos, const parsed_command& cmd)
 {
 	if (processing_type_ == comment_process_type_off)
 		return;
@@ -46,36 +103,39 @@ void gcode_comment_processor::update(position& pos)
 		update_feature_from_section(pos);
 		return;
 	}		
+	// Only comments can change the feature type from here on
+	if (cmd.comment.length() == 0)
+		return;
+
+	if (processing_type_ == comment_process_type_unknown && slicer_detection_comments_remaining_ > 0)
+	{
+		detect_slicer(cmd.comment);
+	}
 
 	if (processing_type_ == comment_process_type_unknown || processing_type_ == comment_process_type_slic3r_pe)
 	{
-		if (update_feature_for_slic3r_pe_comment(pos, pos.command.comment))
+		if (update_feature_for_slic3r_pe_comment(pos, cmd.comment))
 			processing_type_ = comment_process_type_slic3r_pe;
 	}
 	
 }
 
-bool gcode_comment_processor::update_feature_for_slic3r_pe_comment(position& pos, std::string &comment) const
+bool gcode_comment_processor::update_feature_for_slic3r_pe_comment(position& pos, const std::string &comment) const
 {
-	if (comment == "perimeter" || comment == "move to first perimeter point")
-	{
-		pos.feature_type_tag = feature_type_unknown_perimeter_feature;
-		return true;
-	}
-	if (comment == "infill" || comment == "move to first infill point")
-	{
-		pos.feature_type_tag = feature_type_infill_feature;
-		return true;
-	}
-	if (comment == "infill(bridge)" || comment == "move to first infill(bridge) point")
-	{
-		pos.feature_type_tag = feature_type_bridge_feature;
-		return true;
-	}
-	if (comment == "skirt" || comment == "move to first skirt point")
+	std::string::size_type length = comment.length();
+	if (length < min_comment_tag_length_ || length > max_comment_tag_length_)
+		return false;
+
+	unsigned int slot = get_comment_hash(comment.c_str(), length) & (COMMENT_TAG_TABLE_SIZE - 1);
+	while (comment_tag_table_[slot] != -1)
 	{
-		pos.feature_type_tag = feature_type_skirt_feature;
-		return true;
+		const comment_tag& tag = slic3r_pe_comment_tags[comment_tag_table_[slot]];
+		if (comment.compare(tag.comment) == 0)
+		{
+			pos.feature_type_tag = tag.tag;
+			return true;
+		}
+		slot = (slot + 1) & (COMMENT_TAG_TABLE_SIZE - 1);
 	}
 	return false;
 }
@@ -61,6 +61,27 @@ enum section_type
 	section_type_prime_pillar_section
 };
 
+// Slic3r PE per line feature comments and the tags they set
+struct comment_tag {
+	const char* comment;
+	feature_type tag;
+};
+#define NUM_SLIC3R_PE_COMMENT_TAGS 8
+static const comment_tag slic3r_pe_comment_tags[NUM_SLIC3R_PE_COMMENT_TAGS] = {
+	{ "perimeter", feature_type_unknown_perimeter_feature },
+	{ "move to first perimeter point", feature_type_unknown_perimeter_feature },
+	{ "infill", feature_type_infill_feature },
+	{ "move to first infill point", feature_type_infill_feature },
+	{ "infill(bridge)", feature_type_bridge_feature },
+	{ "move to first infill(bridge) point", feature_type_bridge_feature },
+	{ "skirt", feature_type_skirt_feature },
+	{ "move to first skirt point", feature_type_skirt_feature }
+};
+// Must be a power of 2 and larger than the number of tags
+#define COMMENT_TAG_TABLE_SIZE 32
+// The slicer is detected from the 'generated by' comment, which is always within the first few comments.
+#define SLICER_DETECTION_MAX_COMMENTS 50
+
 class gcode_comment_processor
 {
 	
@@ -68,20 +89,28 @@ public:
 	
 	gcode_comment_processor();
 	~gcode_comment_processor();
-	void update(position& pos);
+	void update(position& pos, const parsed_command& cmd);
 	void update(std::string & comment);
 	comment_process_type get_comment_process_type();
 
 private:
 	section_type current_section_;
 	comment_process_type processing_type_;
+	int slicer_detection_comments_remaining_;
+	// Open addressing hash table of indexes into slic3r_pe_comment_tags, -1 for empty slots
+	int comment_tag_table_[COMMENT_TAG_TABLE_SIZE];
+	std::string::size_type min_comment_tag_length_;
+	std::string::size_type max_comment_tag_length_;
+	void build_comment_tag_table();
+	static unsigned int get_comment_hash(const char* comment, std::string::size_type length);
+	void detect_slicer(const std::string& comment);
 	void update_feature_from_section(position& pos) const;
 	bool update_feature_from_section_from_section(position& pos) const;
 	bool update_feature_from_section_for_cura(position& pos) const;
 	bool update_feature_from_section_for_simplify_3d(position& pos) const;
 	bool update_feature_from_section_for_slice3r_pe(position& pos) const;
 	void update_feature_for_unknown_slicer_comment(position& pos, std::string &comment);
-	bool update_feature_for_slic3r_pe_comment(position& pos, std::string &comment) const;
+	bool update_feature_for_slic3r_pe_comment(position& pos, const std::string &comment) const;
 	void update_unknown_section(std::string & comment);
 	bool update_cura_section(std::string &comment);
 	bool update_simplify_3d_section(std::string &comment);
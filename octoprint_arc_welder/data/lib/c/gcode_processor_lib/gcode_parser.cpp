@@ -121,8 +121,16 @@ bool gcode_parser::try_parse_gcode(const char* gcode, parsed_command& command)
 {
 	  return try_parse_gcode(gcode, command, true)	 ;
 }
-// Superfast gcode parser - v2
 bool gcode_parser::try_parse_gcode(const char * gcode, parsed_command & command, bool preserve_format)
+{
+	// Nearly every line a slicer emits is a plain G0/G1, try the fast path first.
+	if (try_parse_canonical_motion(gcode, command, preserve_format))
+		return true;
+	return try_parse_gcode_general(gcode, command, preserve_format);
+}
+
+// Superfast gcode parser - v2
+bool gcode_parser::try_parse_gcode_general(const char * gcode, parsed_command & command, bool preserve_format)
 {
 	// Create a command
 	char * p_gcode = const_cast<char *>(gcode);
@@ -433,36 +441,119 @@ double gcode_parser::ten_pow(unsigned short n) {
 	return r;
 }
 
-bool gcode_parser::try_extract_double(char ** p_p_gcode, double * p_double) const
+// Fast path for canonical motion lines like 'G1 X10.5 Y20.25 E0.0123'.  Only an uppercase G0 or G1
+// followed by single space separated X, Y, Z, E or F words is accepted.  Anything else returns false
+// without touching the command so that the general parser can deal with it.
+bool gcode_parser::try_parse_canonical_motion(const char* gcode, parsed_command& command, bool preserve_format)
+{
+	static const int max_parameters = 8;
+	char* p = const_cast<char*>(gcode);
+	if (p[0] != 'G' || (p[1] != '0' && p[1] != '1'))
+		return false;
+	p += 2;
+
+	char names[max_parameters];
+	double values[max_parameters];
+	long long fixed_values[max_parameters];
+	bool has_fixed_value = true;
+	int num_parameters = 0;
+	while (*p == ' ')
+	{
+		char name = p[1];
+		if (name != 'X' && name != 'Y' && name != 'Z' && name != 'E' && name != 'F')
+			break;
+		if (num_parameters == max_parameters)
+			return false;
+		char* p_value = p + 2;
+		// Values too large for fixed point are left to the general parser
+		if (!try_extract_number<false>(&p_value, &values[num_parameters], &fixed_values[num_parameters], &has_fixed_value) || !has_fixed_value)
+			return false;
+		names[num_parameters++] = name;
+		p = p_value;
+	}
+
+	// Only whitespace may follow the parameters, else this line isn't canonical.
+	char* p_end = p;
+	while (*p == ' ' || *p == '\r' || *p == '\n')
+		p++;
+	if (*p != '\0' && *p != ';')
+		return false;
+
+	command.command.append(gcode, 2);
+	command.is_known_command = true;
+	command.is_empty = false;
+	// This matches what the general parser produces (raw text when preserving the format, trimmed otherwise).
+	if (preserve_format)
+		command.gcode.append(gcode, p - gcode);
+	else
+		command.gcode.append(gcode, p_end - gcode);
+
+	for (int index = 0; index < num_parameters; index++)
+	{
+		command.parameters.push_back(parsed_command_parameter());
+		parsed_command_parameter& parameter = command.parameters.back();
+		parameter.name = names[index];
+		parameter.value_type = 'F';
+		parameter.double_value = values[index];
+		parameter.fixed_value = fixed_values[index];
+		parameter.has_fixed_value = true;
+	}
+	try_extract_comment(&p, &(command.comment));
+	return true;
+}
+
+// Multipliers to convert a fraction with n digits (the index) into a fixed point value
+static const long long fixed_point_fraction_multipliers[FIXED_POINT_DIGITS + 1] = {
+	1000000000LL, 100000000LL, 10000000LL, 1000000LL, 100000LL, 10000LL, 1000LL, 100LL, 10LL, 1LL
+};
+// Shared number parser.  The general parser tolerates whitespace within numbers, the canonical
+// fast path does not.  The arithmetic must be identical for both so the results match exactly.
+// The fixed point value is calculated from the digits directly, rounding beyond FIXED_POINT_DIGITS.  If the integer
+// part reaches FIXED_POINT_MAX_INTEGER, only the double is returned, *p_fixed is 0 and *p_has_fixed is false.
+template <bool allow_whitespace>
+bool gcode_parser::try_extract_number(char ** p_p_gcode, double * p_double, long long * p_fixed, bool * p_has_fixed)
 {
 	char * p = *p_p_gcode;
 	bool neg = false;
 	double r = 0;
+	long long fixed_integer = 0;
+	long long fixed_fraction = 0;
+	unsigned short fixed_digits = 0;
+	bool fixed_round_up = false;
+	bool has_fixed = true;
 	bool found_numbers = false;
 	// skip any leading whitespace
-	while (*p == ' ')
+	while (allow_whitespace && *p == ' ')
 		++p;
 	// Check for negative sign
 	if (*p == '-') {
 		neg = true;
 		++p;
-		while (*p == ' ')
+		while (allow_whitespace && *p == ' ')
 			++p;
 	}
 	else if (*p == '+') {
 		// Positive sign doesn't affect anything since we assume positive
 		++p;
-		while (*p == ' ')
+		while (allow_whitespace && *p == ' ')
 			++p;
 	}
-	// skip any additional whitespace
-	
 
-	while ((*p >= '0' && *p <= '9') || *p == ' ') {
+	while ((*p >= '0' && *p <= '9') || (allow_whitespace && *p == ' ')) {
 		if (*p != ' ')
 		{
 			found_numbers = true;
 			r = (r*10.0) + (*p - '0');
+			// fixed_integer stays below FIXED_POINT_MAX_INTEGER, so neither this nor the scaling below can overflow
+			if (has_fixed)
+			{
+				fixed_integer = (fixed_integer * 10) + (*p - '0');
+				if (fixed_integer >= FIXED_POINT_MAX_INTEGER)
+				{
+					has_fixed = false;
+					fixed_integer = 0;
+				}
+			}
 		}
 		++p;
 	}
@@ -470,23 +561,37 @@ bool gcode_parser::try_extract_double(char ** p_p_gcode, double * p_double) cons
 		double f = 0.0;
 		unsigned short n = 0;
 		++p;
-		while ((*p >= '0' && *p <= '9') || *p == ' ') {
+		while ((*p >= '0' && *p <= '9') || (allow_whitespace && *p == ' ')) {
 			if (*p != ' ')
 			{
 				found_numbers = true;
 				f = (f*10.0) + (*p - '0');
+				if (n < FIXED_POINT_DIGITS)
+					fixed_fraction = (fixed_fraction * 10) + (*p - '0');
+				else if (n == FIXED_POINT_DIGITS)
+					fixed_round_up = *p >= '5';
 				++n;
 			}
 			++p;
 		}
 		//r += f / pow(10.0, n);
 		r += f / ten_pow(n);
+		fixed_digits = n < FIXED_POINT_DIGITS ? n : FIXED_POINT_DIGITS;
 	}
 	if (neg) {
 		r = -r;
 	}
 	if (found_numbers)
 	{
+		long long fixed = 0;
+		if (has_fixed)
+		{
+			fixed = fixed_integer * FIXED_POINT_SCALE + fixed_fraction * fixed_point_fraction_multipliers[fixed_digits];
+			if (fixed_round_up)
+				fixed++;
+		}
+		*p_fixed = neg ? -fixed : fixed;
+		*p_has_fixed = has_fixed;
 		*p_double = r;
 		*p_p_gcode = p;
 	}
@@ -494,6 +599,11 @@ bool gcode_parser::try_extract_double(char ** p_p_gcode, double * p_double) cons
 	return found_numbers;
 }
 
+bool gcode_parser::try_extract_double(char ** p_p_gcode, double * p_double, long long * p_fixed, bool * p_has_fixed) const
+{
+	return try_extract_number<true>(p_p_gcode, p_double, p_fixed, p_has_fixed);
+}
+
 bool gcode_parser::try_extract_text_parameter(char ** p_p_gcode, std::string * p_parameter)
 {
 	// Skip initial whitespace
@@ -594,7 +704,7 @@ bool gcode_parser::try_extract_parameter(char ** p_p_gcode, parsed_command_param
 	// TODO:  See if unsigned long works....
 
 	// Add all values, stop at end of string or when we hit a ';'
-	if (try_extract_double(&p,&(parameter->double_value)))
+	if (try_extract_double(&p, &(parameter->double_value), &(parameter->fixed_value), &(parameter->has_fixed_value)))
 	{
 		parameter->value_type = 'F';
 	}
@@ -38,13 +38,19 @@ public:
 	bool try_parse_gcode(const char* gcode, parsed_command& command, bool preserve_format);
 	parsed_command parse_gcode(const char * gcode);
 	parsed_command parse_gcode(const char* gcode, bool preserve_format);
+	// Parses with the general parser only, skipping the canonical motion fast path.  Both give the same result, which
+	// test/gcode_parser_test.cpp checks.
+	bool try_parse_gcode_general(const char* gcode, parsed_command& command, bool preserve_format);
 private:
 	gcode_parser(const gcode_parser &source);
 	// Variables and lookups
 	std::set<std::string> text_only_functions_;
 	std::set<std::string> parsable_commands_;
 	// Functions
-	bool try_extract_double(char ** p_p_gcode, double * p_double) const;
+	bool try_parse_canonical_motion(const char * gcode, parsed_command & command, bool preserve_format);
+	template <bool allow_whitespace>
+	static bool try_extract_number(char ** p_p_gcode, double * p_double, long long * p_fixed, bool * p_has_fixed);
+	bool try_extract_double(char ** p_p_gcode, double * p_double, long long * p_fixed, bool * p_has_fixed) const;
 	static bool try_extract_gcode_command(char ** p_p_gcode, std::string * p_command);
 	static bool try_extract_text_parameter(char ** p_p_gcode, std::string * p_parameter);
 	bool try_extract_parameter(char ** p_p_gcode, parsed_command_parameter * parameter) const;
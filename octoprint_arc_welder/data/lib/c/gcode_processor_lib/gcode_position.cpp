@@ -46,6 +46,7 @@ gcode_position_args::gcode_position_args(const gcode_position_args &pos_args)
 	e_axis_default_mode = pos_args.e_axis_default_mode;
 	units_default = pos_args.units_default;
 	is_bound_ = pos_args.is_bound_;
+	motion_only = pos_args.motion_only;
 	x_min = pos_args.x_min;
 	x_max = pos_args.x_max;
 	y_min = pos_args.y_min;
@@ -107,6 +108,7 @@ gcode_position_args& gcode_position_args::operator=(const gcode_position_args& p
 	e_axis_default_mode = pos_args.e_axis_default_mode;
 	units_default = pos_args.units_default;
 	is_bound_ = pos_args.is_bound_;
+	motion_only = pos_args.motion_only;
 	x_min = pos_args.x_min;
 	x_max = pos_args.x_max;
 	y_min = pos_args.y_min;
@@ -210,6 +212,9 @@ gcode_position::gcode_position()
 {
 	position_buffer_size_ = 50;
 	positions_ = new position[position_buffer_size_];
+	commands_ = new parsed_command[position_buffer_size_];
+	snapshot_states_ = new snapshot_state[position_buffer_size_];
+	extruder_changes_ = new extruder_table_change[position_buffer_size_];
 	autodetect_position_ = false;
 	home_x_ = 0;
 	home_y_ = 0;
@@ -219,6 +224,7 @@ gcode_position::gcode_position()
 	home_z_none_ = true;
 	retraction_lengths_ = NULL;
 	z_lift_heights_ = NULL;
+	extruders_ = NULL;
 	shared_extruder_ = false;
 	set_num_extruders(0);
 	zero_based_extruder_ = true;
@@ -232,6 +238,7 @@ gcode_position::gcode_position()
 	gcode_functions_ = get_gcode_functions();
 
 	is_bound_ = false;
+	motion_only_ = false;
 	snapshot_x_min_ = 0;
 	snapshot_x_max_ = 0;
 	snapshot_y_min_ = 0;
@@ -249,13 +256,14 @@ gcode_position::gcode_position()
 
 	cur_pos_ = -1;
 	num_pos_ = 0;
+	num_undone_ = 0;
 	for(int index = 0; index < position_buffer_size_; index ++)
 	{
-		position initial_pos(num_extruders_);
+		position initial_pos;
 		initial_pos.set_xyz_axis_mode(xyz_axis_default_mode_);
 		initial_pos.set_e_axis_mode(e_axis_default_mode_);
-		initial_pos.set_units_default(units_default_);
 		add_position(initial_pos);
+		snapshot_states_[cur_pos_].set_units_default(units_default_);
 	}
 	num_pos_ = 0;
 }
@@ -264,6 +272,9 @@ gcode_position::gcode_position(gcode_position_args args)
 {
 	position_buffer_size_ = args.position_buffer_size;
 	positions_ = new position[args.position_buffer_size] ;
+	commands_ = new parsed_command[args.position_buffer_size];
+	snapshot_states_ = new snapshot_state[args.position_buffer_size];
+	extruder_changes_ = new extruder_table_change[args.position_buffer_size];
 	autodetect_position_ = args.autodetect_position;
 	home_x_ = args.home_x;
 	home_y_ = args.home_y;
@@ -273,6 +284,7 @@ gcode_position::gcode_position(gcode_position_args args)
 	home_z_none_ = args.home_z_none;
 	retraction_lengths_ = NULL;
 	z_lift_heights_ = NULL;
+	extruders_ = NULL;
 	// Configure Extruders
 	shared_extruder_ = args.shared_extruder;
 	set_num_extruders(args.num_extruders);
@@ -315,6 +327,7 @@ gcode_position::gcode_position(gcode_position_args args)
 	gcode_functions_ = get_gcode_functions();
 
 	is_bound_ = args.is_bound_;
+	motion_only_ = args.motion_only;
 	snapshot_x_min_ = args.snapshot_x_min;
 	snapshot_x_max_ = args.snapshot_x_max;
 	snapshot_y_min_ = args.snapshot_y_min;
@@ -333,24 +346,30 @@ gcode_position::gcode_position(gcode_position_args args)
 
 	cur_pos_ = -1;
 	num_pos_ = 0;
+	num_undone_ = 0;
 	num_extruders_ = args.num_extruders;
 
+	// Configure the extruders
+	for (int index = 0; index < args.num_extruders; index++)
+	{
+		extruders_[index].x_firmware_offset = args.x_firmware_offsets[index];
+		extruders_[index].y_firmware_offset = args.y_firmware_offsets[index];
+		extruders_[index].x_firmware_offset_fixed = utilities::to_fixed(args.x_firmware_offsets[index]);
+		extruders_[index].y_firmware_offset_fixed = utilities::to_fixed(args.y_firmware_offsets[index]);
+	}
+
 	// Configure the initial position
-	position initial_pos(num_extruders_);
+	position initial_pos;
 	initial_pos.set_xyz_axis_mode(xyz_axis_default_mode_);
 	initial_pos.set_e_axis_mode(e_axis_default_mode_);
-	initial_pos.set_units_default(units_default_);
 	initial_pos.current_tool = current_extruder;
-	for (int index = 0; index < args.num_extruders; index++)
-	{
-		initial_pos.p_extruders[index].x_firmware_offset = args.x_firmware_offsets[index];
-		initial_pos.p_extruders[index].y_firmware_offset = args.y_firmware_offsets[index];
-	}
+	initial_pos.current_extruder = extruders_[current_extruder];
 
 	for (int index = 0; index < position_buffer_size_; index++)
 	{
 
 		add_position(initial_pos);
+		snapshot_states_[cur_pos_].set_units_default(units_default_);
 	}
 	num_pos_ = 0;
 }
@@ -367,8 +386,24 @@ gcode_position::~gcode_position()
 		delete  [] positions_;
 		positions_ = NULL;
 	}
+	if (commands_ != NULL)
+	{
+		delete[] commands_;
+		commands_ = NULL;
+	}
+	if (snapshot_states_ != NULL)
+	{
+		delete[] snapshot_states_;
+		snapshot_states_ = NULL;
+	}
+	if (extruder_changes_ != NULL)
+	{
+		delete[] extruder_changes_;
+		extruder_changes_ = NULL;
+	}
 	delete_retraction_lengths_();
 	delete_z_lift_heights_();
+	delete_extruders_();
 }
 
 bool gcode_position::get_g90_91_influences_extruder()
@@ -381,6 +416,7 @@ void gcode_position::set_num_extruders(int num_extruders)
 {
 	delete_retraction_lengths_();
 	delete_z_lift_heights_();
+	delete_extruders_();
 	if (shared_extruder_)
 	{
 		num_extruders_ = 1;
@@ -391,6 +427,7 @@ void gcode_position::set_num_extruders(int num_extruders)
 	}
 	retraction_lengths_ = new double[num_extruders];
 	z_lift_heights_ = new double[num_extruders];
+	extruders_ = new extruder[num_extruders > 0 ? num_extruders : 1];
 }
 
 void gcode_position::delete_retraction_lengths_()
@@ -402,6 +439,53 @@ void gcode_position::delete_retraction_lengths_()
 	}
 }
 
+void gcode_position::delete_extruders_()
+{
+	if (extruders_ != NULL)
+	{
+		delete[] extruders_;
+		extruders_ = NULL;
+	}
+}
+
+extruder& gcode_position::get_tool_extruder_(position* pos, int tool)
+{
+	if (tool == pos->current_tool)
+		return pos->current_extruder;
+	return extruders_[tool];
+}
+
+// Like get_tool_extruder_, but a table extruder is saved first (see save_extruder_change_)
+extruder& gcode_position::get_tool_extruder_for_update_(position* pos, int tool)
+{
+	if (tool == pos->current_tool)
+		return pos->current_extruder;
+	save_extruder_change_(tool);
+	return extruders_[tool];
+}
+
+// Keeps the value of a table extruder with the current position before it is changed, so that undo_update can put
+// it back.
+void gcode_position::save_extruder_change_(int tool)
+{
+	extruder_table_change& change = extruder_changes_[cur_pos_];
+	if (change.tool != tool)
+	{
+		change.tool = tool;
+		change.other_value = extruders_[tool];
+	}
+}
+
+void gcode_position::swap_extruder_change_(int index)
+{
+	extruder_table_change& change = extruder_changes_[index];
+	if (change.tool < 0)
+		return;
+	const extruder value = extruders_[change.tool];
+	extruders_[change.tool] = change.other_value;
+	change.other_value = value;
+}
+
 void gcode_position::delete_z_lift_heights_()
 {
 	if (z_lift_heights_ != NULL)
@@ -420,8 +504,10 @@ void gcode_position::add_position(position& pos)
 {
 	cur_pos_ = (cur_pos_+1) % position_buffer_size_;
 	positions_[cur_pos_] = pos;
+	extruder_changes_[cur_pos_].tool = -1;
 	if (num_pos_ < position_buffer_size_)
 		num_pos_++;
+	num_undone_ = 0;
 }
 
 void gcode_position::add_position(parsed_command& cmd)
@@ -430,10 +516,17 @@ void gcode_position::add_position(parsed_command& cmd)
 	cur_pos_ = (cur_pos_+1) % position_buffer_size_;
 	positions_[cur_pos_] = positions_[prev_pos];
 	positions_[cur_pos_].reset_state();
-	positions_[cur_pos_].command = cmd;
-	positions_[cur_pos_].is_empty = false;
+	commands_[cur_pos_] = cmd;
+	extruder_changes_[cur_pos_].tool = -1;
+	if (!motion_only_)
+	{
+		snapshot_states_[cur_pos_] = snapshot_states_[prev_pos];
+		snapshot_states_[cur_pos_].reset_state();
+		snapshot_states_[cur_pos_].is_empty = false;
+	}
 	if (num_pos_ < position_buffer_size_)
 		num_pos_++;
+	num_undone_ = 0;
 }
 
 position gcode_position::get_position(int index)
@@ -456,6 +549,26 @@ position * gcode_position::get_position_ptr(int index)
 	return &positions_[(cur_pos_ - index + position_buffer_size_) % position_buffer_size_]; 
 }
 
+parsed_command * gcode_position::get_command_ptr(int index)
+{
+	return &commands_[(cur_pos_ - index + position_buffer_size_) % position_buffer_size_];
+}
+
+parsed_command * gcode_position::get_current_command_ptr()
+{
+	return get_command_ptr(0);
+}
+
+snapshot_state * gcode_position::get_snapshot_state_ptr(int index)
+{
+	return &snapshot_states_[(cur_pos_ - index + position_buffer_size_) % position_buffer_size_];
+}
+
+snapshot_state * gcode_position::get_current_snapshot_state_ptr()
+{
+	return get_snapshot_state_ptr(0);
+}
+
 position * gcode_position::get_current_position_ptr()
 {
 	return get_position_ptr(0);
@@ -467,7 +580,16 @@ position * gcode_position::get_previous_position_ptr()
 	return get_position_ptr(1);
 }
 
-void gcode_position::update(parsed_command& command, const long file_line_number, const long gcode_number, const long file_position)
+void gcode_position::update(parsed_command& command, const long long file_line_number, const long long gcode_number, const long long file_position)
+{
+	if (motion_only_)
+		update_<true>(command, file_line_number, gcode_number, file_position);
+	else
+		update_<false>(command, file_line_number, gcode_number, file_position);
+}
+
+template <bool motion_only>
+void gcode_position::update_(parsed_command& command, const long long file_line_number, const long long gcode_number, const long long file_position)
 {
 	
 	/*if (command.is_empty)
@@ -480,10 +602,15 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 	add_position(command);
 	position * p_current_pos = get_current_position_ptr();
 	position * p_previous_pos = get_previous_position_ptr();
-	p_current_pos->file_line_number = file_line_number;
-	p_current_pos->gcode_number = gcode_number;
-	p_current_pos->file_position = file_position;
-	comment_processor_.update(*p_current_pos);
+	// Only used when not in motion only mode
+	snapshot_state * p_current_state = get_current_snapshot_state_ptr();
+	if (!motion_only)
+	{
+		p_current_state->file_line_number = file_line_number;
+		p_current_state->gcode_number = gcode_number;
+		p_current_state->file_position = file_position;
+	}
+	comment_processor_.update(*p_current_pos, command);
 
 	if (!command.is_known_command || command.is_empty)
 		return;
@@ -493,13 +620,17 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 
 	if (gcode_functions_iterator_ != gcode_functions_.end())
 	{
-		p_current_pos->gcode_ignored = false;
+		if (!motion_only)
+			p_current_state->gcode_ignored = false;
 		// Execute the function to process this gcode
 		const pos_function_type func = gcode_functions_iterator_->second;
 		(this->*func)(p_current_pos, command);
 		// calculate z and e relative distances
-		p_current_pos->get_current_extruder().e_relative = (p_current_pos->get_current_extruder().e - p_previous_pos->get_extruder(p_current_pos->current_tool).e);
-		p_current_pos->z_relative = (p_current_pos->z - p_previous_pos->z);
+		const extruder& previous_extruder = get_tool_extruder_(p_previous_pos, p_current_pos->current_tool);
+		p_current_pos->get_current_extruder().e_relative = (p_current_pos->get_current_extruder().e - previous_extruder.e);
+		p_current_pos->get_current_extruder().e_relative_fixed = (p_current_pos->get_current_extruder().e_fixed - previous_extruder.e_fixed);
+		if (!motion_only)
+			p_current_state->z_relative = (p_current_pos->z - p_previous_pos->z);
 		// Have the XYZ positions changed after processing a command ?
 
 		p_current_pos->has_xy_position_changed = (
@@ -515,14 +646,14 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 			p_current_pos->z_null != p_previous_pos->z_null);
 
 		// see if our position is homed
-		if (!p_current_pos->has_definite_position)
+		if (!motion_only && !p_current_state->has_definite_position)
 		{
-			p_current_pos->has_definite_position = (
+			p_current_state->has_definite_position = (
 				//p_current_pos->x_homed_ &&
 				//p_current_pos->y_homed_ &&
 				//p_current_pos->z_homed_ &&
-				p_current_pos->is_metric &&
-				!p_current_pos->is_metric_null &&
+				p_current_state->is_metric &&
+				!p_current_state->is_metric_null &&
 				!p_current_pos->x_null &&
 				!p_current_pos->y_null &&
 				!p_current_pos->z_null &&
@@ -533,6 +664,7 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 
 	if (p_current_pos->has_position_changed)
 	{
+		const extruder& previous_extruder = get_tool_extruder_(p_previous_pos, p_current_pos->current_tool);
 		p_current_pos->get_current_extruder().extrusion_length_total += p_current_pos->get_current_extruder().e_relative;
 
 		if (
@@ -562,12 +694,15 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 				p_current_pos->get_current_extruder().extrusion_length = 0;
 
 			// calculate deretraction length
-			if (utilities::greater_than(p_previous_pos->get_extruder(p_current_pos->current_tool).retraction_length, p_current_pos->get_current_extruder().retraction_length))
+			if (!motion_only)
 			{
-				p_current_pos->get_current_extruder().deretraction_length = p_previous_pos->get_extruder(p_current_pos->current_tool).retraction_length - p_current_pos->get_current_extruder().retraction_length;
+				if (utilities::greater_than(previous_extruder.retraction_length, p_current_pos->get_current_extruder().retraction_length))
+				{
+					p_current_pos->get_current_extruder().deretraction_length = previous_extruder.retraction_length - p_current_pos->get_current_extruder().retraction_length;
+				}
+				else
+					p_current_pos->get_current_extruder().deretraction_length = 0;
 			}
-			else
-				p_current_pos->get_current_extruder().deretraction_length = 0;
 
 			// *************Calculate extruder state*************
 			// rounding should all be done by now
@@ -580,8 +715,11 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 				p_current_pos->get_current_extruder().is_extruding = utilities::greater_than(p_current_pos->get_current_extruder().extrusion_length, 0);
 				p_current_pos->get_current_extruder().is_retracting_start = !p_previous_pos->get_current_extruder().is_retracting && utilities::greater_than(p_current_pos->get_current_extruder().retraction_length, 0);
 				p_current_pos->get_current_extruder().is_retracting = utilities::greater_than(p_current_pos->get_current_extruder().retraction_length, p_previous_pos->get_current_extruder().retraction_length);
-				p_current_pos->get_current_extruder().is_deretracting = utilities::greater_than(p_current_pos->get_current_extruder().deretraction_length, p_previous_pos->get_current_extruder().deretraction_length);
-				p_current_pos->get_current_extruder().is_deretracting_start = utilities::greater_than(p_current_pos->get_current_extruder().deretraction_length, 0) && !p_previous_pos->get_current_extruder().is_deretracting;
+				if (!motion_only)
+				{
+					p_current_pos->get_current_extruder().is_deretracting = utilities::greater_than(p_current_pos->get_current_extruder().deretraction_length, p_previous_pos->get_current_extruder().deretraction_length);
+					p_current_pos->get_current_extruder().is_deretracting_start = utilities::greater_than(p_current_pos->get_current_extruder().deretraction_length, 0) && !p_previous_pos->get_current_extruder().is_deretracting;
+				}
 			}
 			else
 			{
@@ -592,13 +730,20 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 				p_current_pos->get_current_extruder().is_deretracting = false;
 				p_current_pos->get_current_extruder().is_deretracting_start = false;
 			}
-			p_current_pos->get_current_extruder().is_primed = utilities::is_zero(p_current_pos->get_current_extruder().extrusion_length) && utilities::is_zero(p_current_pos->get_current_extruder().retraction_length);
-			p_current_pos->get_current_extruder().is_partially_retracted = utilities::greater_than(p_current_pos->get_current_extruder().retraction_length, 0) && utilities::less_than(p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
-			p_current_pos->get_current_extruder().is_retracted = utilities::greater_than_or_equal(p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
-			p_current_pos->get_current_extruder().is_deretracted = utilities::greater_than(p_previous_pos->get_extruder(p_current_pos->current_tool).retraction_length, 0) && utilities::is_zero(p_current_pos->get_current_extruder().retraction_length);
+			if (!motion_only)
+			{
+				p_current_pos->get_current_extruder().is_primed = utilities::is_zero(p_current_pos->get_current_extruder().extrusion_length) && utilities::is_zero(p_current_pos->get_current_extruder().retraction_length);
+				p_current_pos->get_current_extruder().is_partially_retracted = utilities::greater_than(p_current_pos->get_current_extruder().retraction_length, 0) && utilities::less_than(p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
+				p_current_pos->get_current_extruder().is_retracted = utilities::greater_than_or_equal(p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
+				p_current_pos->get_current_extruder().is_deretracted = utilities::greater_than(previous_extruder.retraction_length, 0) && utilities::is_zero(p_current_pos->get_current_extruder().retraction_length);
+			}
 			// *************End Calculate extruder state*************
 		}
 
+		// The motion only tracker stops here, the rest is only needed for snapshots
+		if (motion_only)
+			return;
+
 		// Calcluate position restructions
 		// TODO:  INCLUDE POSITION RESTRICTION CALCULATIONS!
 		// Set is_in_bounds_ to false if we're not in bounds, it will be true at this point
@@ -625,56 +770,56 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 				is_in_bounds = utilities::less_than_or_equal(dist, r);
 
 			}
-			p_current_pos->is_in_bounds = is_in_bounds;
+			p_current_state->is_in_bounds = is_in_bounds;
 		}
 
 		// calculate last_extrusion_height and height
 		// If we are extruding on a higher level, or if retract is enabled and the nozzle is primed
 		// adjust the last extrusion height
-		if (utilities::greater_than(p_current_pos->z, p_current_pos->last_extrusion_height))
+		if (utilities::greater_than(p_current_pos->z, p_current_state->last_extrusion_height))
 		{
 			if (!p_current_pos->z_null)
 			{
 				// detect layer changes/ printer priming/last extrusion height and height 
 				// Normally we would only want to use is_extruding, but we can also use is_deretracted if the layer is greater than 0
-				if (p_current_pos->get_current_extruder().is_extruding || (p_current_pos->layer >0 && p_current_pos->get_current_extruder().is_deretracted))
+				if (p_current_pos->get_current_extruder().is_extruding || (p_current_state->layer >0 && p_current_pos->get_current_extruder().is_deretracted))
 				{
 					// Is Primed
-					if (!p_current_pos->is_printer_primed)
+					if (!p_current_state->is_printer_primed)
 					{
 						// We haven't primed yet, check to see if we have priming height restrictions
 						if (utilities::greater_than(priming_height_, 0))
 						{
 							// if a priming height is configured, see if we've extruded below the  height
 							if (utilities::less_than(p_current_pos->z, priming_height_))
-								p_current_pos->is_printer_primed = true;
+								p_current_state->is_printer_primed = true;
 						}
 						else
 							// if we have no priming height set, just set is_printer_primed = true.
-							p_current_pos->is_printer_primed = true;
+							p_current_state->is_printer_primed = true;
 					}
 
-					if (p_current_pos->is_printer_primed && is_in_bounds)
+					if (p_current_state->is_printer_primed && is_in_bounds)
 					{
 						// Update the last extrusion height
-						p_current_pos->last_extrusion_height = p_current_pos->z;
-						p_current_pos->last_extrusion_height_null = false;
+						p_current_state->last_extrusion_height = p_current_pos->z;
+						p_current_state->last_extrusion_height_null = false;
 
 						// Calculate current height
-						if (utilities::greater_than_or_equal(p_current_pos->z, p_previous_pos->height + minimum_layer_height_))
+						if (utilities::greater_than_or_equal(p_current_pos->z, get_snapshot_state_ptr(1)->height + minimum_layer_height_))
 						{
-							p_current_pos->height = p_current_pos->z;
-							p_current_pos->is_layer_change = true;
-							p_current_pos->layer++;
+							p_current_state->height = p_current_pos->z;
+							p_current_state->is_layer_change = true;
+							p_current_state->layer++;
 							if (height_increment_ != 0)
 							{
-								const double increment_double = p_current_pos->height / height_increment_;
+								const double increment_double = p_current_state->height / height_increment_;
 								const int increment = utilities::round_up_to_int(increment_double);
-								if (increment > p_current_pos->height_increment && increment > 1)
+								if (increment > p_current_state->height_increment && increment > 1)
 								{
-									p_current_pos->height_increment = increment;
-									p_current_pos->is_height_increment_change = true;
-									p_current_pos->height_increment_change_count++;
+									p_current_state->height_increment = increment;
+									p_current_state->is_height_increment_change = true;
+									p_current_state->height_increment_change_count++;
 								}
 							}
 						}
@@ -682,10 +827,10 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 				}
 
 				// calculate is_zhop
-				if (p_current_pos->get_current_extruder().is_extruding || p_current_pos->z_null || p_current_pos->last_extrusion_height_null)
-					p_current_pos->is_zhop = false;
+				if (p_current_pos->get_current_extruder().is_extruding || p_current_pos->z_null || p_current_state->last_extrusion_height_null)
+					p_current_state->is_zhop = false;
 				else
-					p_current_pos->is_zhop = utilities::greater_than_or_equal(p_current_pos->z - p_current_pos->last_extrusion_height, z_lift_heights_[p_current_pos->current_tool]);
+					p_current_state->is_zhop = utilities::greater_than_or_equal(p_current_pos->z - p_current_state->last_extrusion_height, z_lift_heights_[p_current_pos->current_tool]);
 			}
 
 		}
@@ -699,37 +844,49 @@ void gcode_position::undo_update()
 {
 	if (num_pos_ != 0)
 	{
+		// Put back the extruder table as it was before this position
+		swap_extruder_change_(cur_pos_);
 		cur_pos_ = (cur_pos_ - 1 + position_buffer_size_) % position_buffer_size_;
 		num_pos_--;
+		num_undone_++;
 	}
 }
 
-position* gcode_position::undo_update(int num_updates)
+int gcode_position::undo_update(int num_updates)
 {
-	if (num_updates < 1)
-		return NULL;
-
-	// Create an array of position pointers that will contain the removed positions
-	position* p_undo_positions = new position[num_updates];
-
-	// add the positions we will undo to the array
-	for (int index = 0; index < num_updates; index++)
+	// Rewind the ring without copying anything.  The undone positions stay where they are until the next update, and
+	// can be read with get_undone_position_ptr or restored with redo_update.
+	int num_undone = 0;
+	while (num_undone < num_updates && num_pos_ != 0)
 	{
-		p_undo_positions[index] = get_position(index);
+		undo_update();
+		num_undone++;
 	}
-	
-	if (num_pos_ < num_updates)
-	{
-		num_pos_ = 0;
-		cur_pos_ = 0;
-	}
-	else
-	{
-		cur_pos_ = (cur_pos_ - num_updates + position_buffer_size_) % position_buffer_size_;
-		num_pos_ -= num_updates;
-	}
-	return p_undo_positions;
+	return num_undone;
+}
 
+bool gcode_position::redo_update()
+{
+	if (num_undone_ == 0)
+		return false;
+	cur_pos_ = (cur_pos_ + 1) % position_buffer_size_;
+	num_pos_++;
+	num_undone_--;
+	swap_extruder_change_(cur_pos_);
+	return true;
+}
+
+int gcode_position::get_num_undone_positions() const
+{
+	return num_undone_;
+}
+
+position * gcode_position::get_undone_position_ptr(int index)
+{
+	// Index 0 is the most recently undone position
+	if (index < 0 || index >= num_undone_)
+		return NULL;
+	return &positions_[(cur_pos_ + 1 + index) % position_buffer_size_];
 }
 
 // Private Members
@@ -761,29 +918,35 @@ std::map<std::string, gcode_position::pos_function_type> gcode_position::get_gco
 void gcode_position::update_position(
 	position* pos, 
 	const double x, 
+	const long long x_fixed,
 	const bool update_x, 
 	const double y, 
+	const long long y_fixed,
 	const bool update_y, 
 	const double z, 
+	const long long z_fixed,
 	const bool update_z, 
 	const double e, 
+	const long long e_fixed,
 	const bool update_e, 
 	const double f, 
 	const bool update_f, 
 	const bool force, 
 	const bool is_g1_g0) const
 {
-	if (is_g1_g0)
+	if (is_g1_g0 && !motion_only_)
 	{
 		if (!update_e)
 		{
+			// The position being updated is always the current one
+			snapshot_state& state = snapshot_states_[cur_pos_];
 			if (update_z)
 			{
-				pos->is_xyz_travel = (update_x || update_y);
+				state.is_xyz_travel = (update_x || update_y);
 			}
 			else
 			{
-				pos->is_xy_travel = (update_x || update_y);
+				state.is_xy_travel = (update_x || update_y);
 			}
 		}
 
@@ -799,21 +962,27 @@ void gcode_position::update_position(
 		if (update_x)
 		{
 			pos->x = x + pos->x_offset - pos->x_firmware_offset;
+			pos->x_fixed = x_fixed + pos->x_offset_fixed - pos->x_firmware_offset_fixed;
 			pos->x_null = false;
 		}
 		if (update_y)
 		{
 			pos->y = y + pos->y_offset - pos->y_firmware_offset;
+			pos->y_fixed = y_fixed + pos->y_offset_fixed - pos->y_firmware_offset_fixed;
 			pos->y_null = false;
 		}
 		if (update_z)
 		{
 			pos->z = z + pos->z_offset - pos->z_firmware_offset;
+			pos->z_fixed = z_fixed + pos->z_offset_fixed - pos->z_firmware_offset_fixed;
 			pos->z_null = false;
 		}
 		// note that e cannot be null and starts at 0
 		if (update_e)
+		{
 			pos->get_current_extruder().e = e + pos->get_current_extruder().e_offset;
+			pos->get_current_extruder().e_fixed = e_fixed + pos->get_current_extruder().e_offset_fixed;
+		}
 		return;
 	}
 
@@ -823,17 +992,26 @@ void gcode_position::update_position(
 			if (update_x)
 			{
 				if (!pos->x_null)
+				{
 					pos->x = x + pos->x;
+					pos->x_fixed = x_fixed + pos->x_fixed;
+				}
 			}
 			if (update_y)
 			{
 				if (!pos->y_null)
+				{
 					pos->y = y + pos->y;
+					pos->y_fixed = y_fixed + pos->y_fixed;
+				}
 			}
 			if (update_z)
 			{
 				if (!pos->z_null)
+				{
 					pos->z = z + pos->z;
+					pos->z_fixed = z_fixed + pos->z_fixed;
+				}
 			}
 		}
 		else
@@ -843,18 +1021,24 @@ void gcode_position::update_position(
 			{
 				pos->x_firmware_offset = pos->get_current_extruder().x_firmware_offset;
 				pos->x = x + pos->x_offset - pos->x_firmware_offset;
+				pos->x_firmware_offset_fixed = pos->get_current_extruder().x_firmware_offset_fixed;
+				pos->x_fixed = x_fixed + pos->x_offset_fixed - pos->x_firmware_offset_fixed;
 				pos->x_null = false;
 			}
 			if (update_y)
 			{
 				pos->y_firmware_offset = pos->get_current_extruder().y_firmware_offset;
 				pos->y = y + pos->y_offset - pos->y_firmware_offset;
+				pos->y_firmware_offset_fixed = pos->get_current_extruder().y_firmware_offset_fixed;
+				pos->y_fixed = y_fixed + pos->y_offset_fixed - pos->y_firmware_offset_fixed;
 				pos->y_null = false;
 			}
 			if (update_z)
 			{
 				pos->z_firmware_offset = pos->get_current_extruder().z_firmware_offset;
 				pos->z = z + pos->z_offset - pos->z_firmware_offset;
+				pos->z_firmware_offset_fixed = pos->get_current_extruder().z_firmware_offset_fixed;
+				pos->z_fixed = z_fixed + pos->z_offset_fixed - pos->z_firmware_offset_fixed;
 				pos->z_null = false;
 			}
 		}
@@ -867,10 +1051,12 @@ void gcode_position::update_position(
 			if (pos->is_extruder_relative)
 			{
 				pos->get_current_extruder().e = e + pos->get_current_extruder().e;
+				pos->get_current_extruder().e_fixed = e_fixed + pos->get_current_extruder().e_fixed;
 			}
 			else
 			{
 				pos->get_current_extruder().e = e + pos->get_current_extruder().e_offset;
+				pos->get_current_extruder().e_fixed = e_fixed + pos->get_current_extruder().e_offset_fixed;
 			}
 		}
 	}
@@ -889,6 +1075,10 @@ void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
 	double z = 0;
 	double e = 0;
 	double f = 0;
+	long long x_fixed = 0;
+	long long y_fixed = 0;
+	long long z_fixed = 0;
+	long long e_fixed = 0;
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
 		const parsed_command_parameter p_cur_param = cmd.parameters[index];
@@ -896,21 +1086,25 @@ void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
 		{
 			update_x = true;
 			x = p_cur_param.double_value;
+			x_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "Y")
 		{
 			update_y = true;
 			y = p_cur_param.double_value;
+			y_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "E")
 		{
 			update_e = true;
 			e = p_cur_param.double_value;
+			e_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "Z")
 		{
 			update_z = true;
 			z = p_cur_param.double_value;
+			z_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "F")
 		{
@@ -918,19 +1112,31 @@ void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
 			f = p_cur_param.double_value;
 		}
 	}
-	update_position(pos, x, update_x, y, update_y, z, update_z, e, update_e, f, update_f, false, true);
+	update_position(pos, x, x_fixed, update_x, y, y_fixed, update_y, z, z_fixed, update_z, e, e_fixed, update_e, f, update_f, false, true);
 }
 
 void gcode_position::process_g2(position* pos, parsed_command& cmd)
 {
 	bool update_x = false;
 	bool update_y = false;
+	bool update_z = false;
 	bool update_e = false;
 	bool update_f = false;
 	double x = 0;
 	double y = 0;
+	double z = 0;
 	double e = 0;
 	double f = 0;
+	long long x_fixed = 0;
+	long long y_fixed = 0;
+	long long z_fixed = 0;
+	long long e_fixed = 0;
+	bool has_i = false;
+	bool has_j = false;
+	bool has_r = false;
+	double i = 0;
+	double j = 0;
+	double r = 0;
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
 		const parsed_command_parameter p_cur_param = cmd.parameters[index];
@@ -938,16 +1144,41 @@ void gcode_position::process_g2(position* pos, parsed_command& cmd)
 		{
 			update_x = true;
 			x = p_cur_param.double_value;
+			x_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "Y")
 		{
 			update_y = true;
 			y = p_cur_param.double_value;
+			y_fixed = p_cur_param.fixed_value;
+		}
+		else if (p_cur_param.name == "I")
+		{
+			has_i = true;
+			i = p_cur_param.double_value;
+		}
+		else if (p_cur_param.name == "J")
+		{
+			has_j = true;
+			j = p_cur_param.double_value;
+		}
+		else if (p_cur_param.name == "R")
+		{
+			has_r = true;
+			r = p_cur_param.double_value;
+		}
+		else if (p_cur_param.name == "Z")
+		{
+			// Helical arcs move Z along with the arc
+			update_z = true;
+			z = p_cur_param.double_value;
+			z_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "E")
 		{
 			update_e = true;
 			e = p_cur_param.double_value;
+			e_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "F")
 		{
@@ -955,7 +1186,34 @@ void gcode_position::process_g2(position* pos, parsed_command& cmd)
 			f = p_cur_param.double_value;
 		}
 	}
-	update_position(pos, x, update_x, y, update_y, 0, false, e, update_e, f, update_f, false, true);
+	double start_x = pos->x;
+	double start_y = pos->y;
+	update_position(pos, x, x_fixed, update_x, y, y_fixed, update_y, z, z_fixed, update_z, e, e_fixed, update_e, f, update_f, false, true);
+
+	// Record the center of the arc so that its length and path are known.  I and J take precedence over R, like they
+	// do in the firmware.
+	bool is_clockwise = cmd.command == "G2";
+	if (has_i || has_j)
+	{
+		pos->is_arc = true;
+		pos->arc_i = i;
+		pos->arc_j = j;
+	}
+	else if (has_r && r != 0 && (pos->x != start_x || pos->y != start_y))
+	{
+		// The center is on the perpendicular bisector of the chord.  A negative radius selects the longer of the two
+		// possible arcs.
+		double dx = pos->x - start_x;
+		double dy = pos->y - start_y;
+		double d = std::sqrt(dx * dx + dy * dy);
+		double h_squared = (r - d / 2.0) * (r + d / 2.0);
+		double h = h_squared > 0 ? std::sqrt(h_squared) : 0;
+		double s = ((is_clockwise != (r < 0)) ? -1.0 : 1.0) * h / d;
+		pos->is_arc = true;
+		pos->arc_i = dx / 2.0 - dy * s;
+		pos->arc_j = dy / 2.0 + dx * s;
+	}
+	pos->is_clockwise = is_clockwise;
 }
 
 void gcode_position::process_g3(position* pos, parsed_command& cmd)
@@ -1043,11 +1301,20 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 			p = num_extruders_ - 1;
 		}
 		if (has_x)
-			pos->get_extruder(p).x_firmware_offset = x;
+		{
+			get_tool_extruder_for_update_(pos, p).x_firmware_offset = x;
+			get_tool_extruder_for_update_(pos, p).x_firmware_offset_fixed = utilities::to_fixed(x);
+		}
 		if (has_y)
-			pos->get_extruder(p).y_firmware_offset = y;
+		{
+			get_tool_extruder_for_update_(pos, p).y_firmware_offset = y;
+			get_tool_extruder_for_update_(pos, p).y_firmware_offset_fixed = utilities::to_fixed(y);
+		}
 		if (has_z)
-			pos->get_extruder(p).z_firmware_offset = z;
+		{
+			get_tool_extruder_for_update_(pos, p).z_firmware_offset = z;
+			get_tool_extruder_for_update_(pos, p).z_firmware_offset_fixed = utilities::to_fixed(z);
+		}
 		return;
 	}
 
@@ -1116,18 +1383,21 @@ void gcode_position::process_g28(position* pos, parsed_command& cmd)
 	if (set_x_home && !home_x_none_)
 	{
 		pos->x = home_x_;
+		pos->x_fixed = utilities::to_fixed(home_x_);
 		pos->x_null = false;
 	}
 	// todo: set error flag on else
 	if (set_y_home && !home_y_none_)
 	{
 		pos->y = home_y_;
+		pos->y_fixed = utilities::to_fixed(home_y_);
 		pos->y_null = false;
 	}
 	// todo: set error flag on else
 	if (set_z_home && !home_z_none_)
 	{
 		pos->z = home_z_;
+		pos->z_fixed = utilities::to_fixed(home_z_);
 		pos->z_null = false;
 	}
 	// todo: set error flag on else
@@ -1182,6 +1452,10 @@ void gcode_position::process_g92(position* pos, parsed_command& cmd)
 	double y = 0;
 	double z = 0;
 	double e = 0;
+	long long x_fixed = 0;
+	long long y_fixed = 0;
+	long long z_fixed = 0;
+	long long e_fixed = 0;
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
 		parsed_command_parameter p_cur_param = cmd.parameters[index];
@@ -1189,21 +1463,25 @@ void gcode_position::process_g92(position* pos, parsed_command& cmd)
 		{
 			update_x = true;
 			x = p_cur_param.double_value;
+			x_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "Y")
 		{
 			update_y = true;
 			y = p_cur_param.double_value;
+			y_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "E")
 		{
 			update_e = true;
 			e = p_cur_param.double_value;
+			e_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "Z")
 		{
 			update_z = true;
 			z = p_cur_param.double_value;
+			z_fixed = p_cur_param.fixed_value;
 		}
 		else if (p_cur_param.name == "O")
 		{
@@ -1223,52 +1501,78 @@ void gcode_position::process_g92(position* pos, parsed_command& cmd)
 	if (!o_exists && !update_x && !update_y && !update_z && !update_e)
 	{
 		if (!pos->x_null)
+		{
 			pos->x_offset = pos->x + pos->x_firmware_offset;
+			pos->x_offset_fixed = pos->x_fixed + pos->x_firmware_offset_fixed;
+		}
 		if (!pos->y_null)
+		{
 			pos->y_offset = pos->y + pos->y_firmware_offset;
+			pos->y_offset_fixed = pos->y_fixed + pos->y_firmware_offset_fixed;
+		}
 		if (!pos->z_null)
+		{
 			pos->z_offset = pos->z + pos->z_firmware_offset;
+			pos->z_offset_fixed = pos->z_fixed + pos->z_firmware_offset_fixed;
+		}
 		// Todo:  Does this reset E too?  Figure that $#$$ out Formerlurker!
 		pos->get_current_extruder().e_offset = pos->get_current_extruder().e;
+		pos->get_current_extruder().e_offset_fixed = pos->get_current_extruder().e_fixed;
 	}
 	else
 	{
 		if (update_x)
 		{
 			if (!pos->x_null && pos->x_homed)
+			{
 				pos->x_offset = pos->x - x + pos->x_firmware_offset;
+				pos->x_offset_fixed = pos->x_fixed - x_fixed + pos->x_firmware_offset_fixed;
+			}
 			else
 			{
 				pos->x = x;
 				pos->x_offset = 0;
+				pos->x_fixed = x_fixed;
+				pos->x_offset_fixed = 0;
 				pos->x_null = false;
 			}
 		}
 		if (update_y)
 		{
 			if (!pos->y_null && pos->y_homed)
+			{
 				pos->y_offset = pos->y - y + pos->y_firmware_offset;
+				pos->y_offset_fixed = pos->y_fixed - y_fixed + pos->y_firmware_offset_fixed;
+			}
 			else
 			{
 				pos->y = y;
 				pos->y_offset = 0;
+				pos->y_fixed = y_fixed;
+				pos->y_offset_fixed = 0;
 				pos->y_null = false;
 			}
 		}
 		if (update_z)
 		{
 			if (!pos->z_null && pos->z_homed)
+			{
 				pos->z_offset = pos->z - z + pos->z_firmware_offset;
+				pos->z_offset_fixed = pos->z_fixed - z_fixed + pos->z_firmware_offset_fixed;
+			}
 			else
 			{
 				pos->z = z;
 				pos->z_offset = 0;
+				pos->z_fixed = z_fixed;
+				pos->z_offset_fixed = 0;
 				pos->z_null = false;
 			}
 		}
 		if (update_e)
 		{
 			pos->get_current_extruder().e_offset = pos->get_current_extruder().e - e;
+			pos->get_current_extruder().e_offset_fixed = pos->get_current_extruder().e_fixed - e_fixed;
 		}
 	}
 }
@@ -1378,11 +1682,20 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 		}
 
 		if (has_x)
-			pos->get_extruder(t).x_firmware_offset = x;
+		{
+			get_tool_extruder_for_update_(pos, t).x_firmware_offset = x;
+			get_tool_extruder_for_update_(pos, t).x_firmware_offset_fixed = utilities::to_fixed(x);
+		}
 		if (has_y)
-			pos->get_extruder(t).y_firmware_offset = y;
+		{
+			get_tool_extruder_for_update_(pos, t).y_firmware_offset = y;
+			get_tool_extruder_for_update_(pos, t).y_firmware_offset_fixed = utilities::to_fixed(y);
+		}
 		if (has_z)
-			pos->get_extruder(t).z_firmware_offset = z;
+		{
+			get_tool_extruder_for_update_(pos, t).z_firmware_offset = z;
+			get_tool_extruder_for_update_(pos, t).z_firmware_offset_fixed = utilities::to_fixed(z);
+		}
 		return;
 	}
 }
@@ -1399,20 +1712,27 @@ void gcode_position::process_t(position* pos, parsed_command& cmd)
 		parsed_command_parameter p_cur_param = cmd.parameters[index];
 		if (p_cur_param.name == "T" && p_cur_param.value_type == 'U')
 		{
-			pos->current_tool = static_cast<int>(p_cur_param.unsigned_long_value);
+			int tool = static_cast<int>(p_cur_param.unsigned_long_value);
 			if (!zero_based_extruder_)
 			{
-				pos->current_tool--;
+				tool--;
+			}
+			if (tool < 0)
+			{
+				tool = 0;
 			}
-			if (pos->current_tool < 0)
+			else if (tool > num_extruders_ - 1)
 			{
-				pos->current_tool = 0;
+				tool = num_extruders_ - 1;
 			}
-			else if (pos->current_tool > num_extruders_ - 1)
+			if (tool != pos->current_tool)
 			{
-				pos->current_tool = num_extruders_ - 1;
+				// Park the extruder for the current tool and load the new one
+				save_extruder_change_(pos->current_tool);
+				extruders_[pos->current_tool] = pos->current_extruder;
+				pos->current_extruder = extruders_[tool];
+				pos->current_tool = tool;
 			}
-			
 			break;
 		}
 	}
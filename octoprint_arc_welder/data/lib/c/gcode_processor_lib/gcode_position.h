@@ -53,6 +53,7 @@ struct gcode_position_args {
 		e_axis_default_mode = "absolute";
 		units_default = "millimeters";
 		is_bound_ = false;
+		motion_only = false;
 		x_min = 0;
 		x_max = 0;
 		y_min = 0;
@@ -98,6 +99,9 @@ struct gcode_position_args {
 	double height_increment;
 	bool g90_influences_extruder;
 	bool is_bound_;
+	// Only track XYZ/E/F, offsets, modes, the extruding and retracting flags and the feature tag.  Homing, layer,
+	// height, z-hop, priming, deretraction and bounds state is not maintained.
+	bool motion_only;
 	double snapshot_x_min;
 	double snapshot_x_max;
 	double snapshot_y_min;
@@ -126,6 +130,20 @@ struct gcode_position_args {
 	void delete_y_firmware_offsets();
 };
 
+// A change that a position made to the extruder of a tool that wasn't current (a tool change parks the outgoing
+// extruder, M218 and G10 can set the offsets of any tool).  Each position makes at most one, and undo_update and
+// redo_update swap it back and forth.
+struct extruder_table_change
+{
+	extruder_table_change()
+	{
+		tool = -1;
+	}
+	// The tool whose table extruder was changed, or -1 if none was
+	int tool;
+	extruder other_value;
+};
+
 class gcode_position
 {
 public:
@@ -134,10 +152,13 @@ public:
 	gcode_position();
 	virtual ~gcode_position();
 
-	void update(parsed_command &command, long file_line_number, long gcode_number, const long file_position);
-	void update_position(position *position, double x, bool update_x, double y, bool update_y, double z, bool update_z, double e, bool update_e, double f, bool update_f, bool force, bool is_g1_g0) const;
+	void update(parsed_command &command, long long file_line_number, long long gcode_number, const long long file_position);
+	void update_position(position *position, double x, long long x_fixed, bool update_x, double y, long long y_fixed, bool update_y, double z, long long z_fixed, bool update_z, double e, long long e_fixed, bool update_e, double f, bool update_f, bool force, bool is_g1_g0) const;
 	void undo_update();
-	position * undo_update(int num_updates);
+	int undo_update(int num_updates);
+	bool redo_update();
+	int get_num_undone_positions() const;
+	position * get_undone_position_ptr(int index);
 	int get_num_positions();
 	position get_position(int index);
 	position get_current_position();
@@ -145,16 +166,32 @@ public:
 	position * get_position_ptr(int index);
 	position * get_current_position_ptr();
 	position * get_previous_position_ptr();
+	parsed_command * get_command_ptr(int index);
+	parsed_command * get_current_command_ptr();
+	snapshot_state * get_snapshot_state_ptr(int index);
+	snapshot_state * get_current_snapshot_state_ptr();
 	gcode_comment_processor* get_gcode_comment_processor();
 	bool get_g90_91_influences_extruder();
 private:
 	gcode_position(const gcode_position &source);
 	int position_buffer_size_;
 	position* positions_;
+	// The commands for each position, using the same index as positions_
+	parsed_command* commands_;
+	// The state only needed for snapshots, using the same index as positions_.  Not maintained in motion only mode.
+	snapshot_state* snapshot_states_;
+	// The extruders for every tool.  The current tool's extruder is stored in the position instead.
+	extruder* extruders_;
+	// The change each position made to extruders_, using the same index as positions_
+	extruder_table_change* extruder_changes_;
 	int cur_pos_;
 	int num_pos_;
+	int num_undone_;
 	void add_position(parsed_command &);
 	void add_position(position &);
+	template <bool motion_only>
+	void update_(parsed_command &command, long long file_line_number, long long gcode_number, const long long file_position);
+	bool motion_only_;
 	bool autodetect_position_;
 	double priming_height_;
 	double home_x_;
@@ -216,7 +253,12 @@ private:
 	gcode_comment_processor comment_processor_;
 	void delete_retraction_lengths_();
 	void delete_z_lift_heights_();
+	void delete_extruders_();
 	void set_num_extruders(int num_extruders);
+	extruder& get_tool_extruder_(position* pos, int tool);
+	extruder& get_tool_extruder_for_update_(position* pos, int tool);
+	void save_extruder_change_(int tool);
+	void swap_extruder_change_(int index);
 };
 
 #endif
@@ -22,25 +22,34 @@
 
 #include "parsed_command_parameter.h"
 #include "parsed_command.h"
+#include "utilities.h"
 parsed_command_parameter::parsed_command_parameter()
 {
 	value_type = 'N';
+	fixed_value = 0;
+	has_fixed_value = false;
 	name.reserve(1);
 }
 
 parsed_command_parameter::parsed_command_parameter(const std::string name, double value) : name(name), double_value(value)
 {
 	value_type = 'F';
+	has_fixed_value = value > -FIXED_POINT_MAX_INTEGER && value < FIXED_POINT_MAX_INTEGER;
+	fixed_value = has_fixed_value ? utilities::to_fixed(value) : 0;
 }
 
 parsed_command_parameter::parsed_command_parameter(const std::string name, const std::string value) : name(name), string_value(value)
 {
 	value_type = 'S';
+	fixed_value = 0;
+	has_fixed_value = false;
 }
 
 parsed_command_parameter::parsed_command_parameter(const std::string name, const unsigned long value) : name(name), unsigned_long_value(value)
 {
 	value_type = 'U';
+	fixed_value = 0;
+	has_fixed_value = false;
 }
 parsed_command_parameter::~parsed_command_parameter()
 {
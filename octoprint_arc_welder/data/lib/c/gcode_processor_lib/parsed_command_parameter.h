@@ -34,6 +34,11 @@ public:
 	std::string name;
 	char value_type;
 	double double_value;
+	// The numeric value in fixed point (see FIXED_POINT_SCALE), parsed without any floating point math
+	long long fixed_value;
+	// False if the value is too large for fixed point (see FIXED_POINT_MAX_INTEGER), in which case only double_value
+	// holds it and fixed_value is 0.
+	bool has_fixed_value;
 	unsigned long unsigned_long_value;
 	std::string string_value;
 };
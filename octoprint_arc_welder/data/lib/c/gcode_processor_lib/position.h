@@ -26,81 +26,103 @@
 #include "parsed_command.h"
 #include "extruder.h"
 
-
+// The tracked printer state for a single gcode line.  This is copied for every line, so keep it trivially copyable:
+// no strings, no containers and no heap pointers.  The command lives in a parallel ring within gcode_position, and
+// only the current tool's extruder is stored here (gcode_position keeps the other tools).  State that only snapshots
+// need lives in snapshot_state, and the members are grouped by size so that there is little padding.
 struct position
 {
 	position();
-	position(int extruder_count);
-	position(const position &pos); // Copy Constructor
-	virtual ~position();
-	position& operator=(const position& pos);
-	std::string to_string(bool rewrite, bool verbose, std::string additional_comment);
+	std::string to_string(parsed_command& command, bool rewrite, bool verbose, std::string additional_comment) const;
 	void reset_state();
-	parsed_command command;
-	int feature_type_tag;
 	double f;
-	bool f_null;
 	double x;
-	bool x_null;
 	double x_offset;
 	double x_firmware_offset;
-	bool x_homed;
 	double y;
-	bool y_null;
 	double y_offset;
 	double y_firmware_offset;
-	bool y_homed;
 	double z;
-	bool z_null;
 	double z_offset;
 	double z_firmware_offset;
+	// Set by G2/G3.  The center of the arc relative to the previous position (from I and J, or calculated from R).
+	double arc_i;
+	double arc_j;
+	// Fixed point copies of the coordinates and offsets (see FIXED_POINT_SCALE)
+	long long x_fixed;
+	long long x_offset_fixed;
+	long long x_firmware_offset_fixed;
+	long long y_fixed;
+	long long y_offset_fixed;
+	long long y_firmware_offset_fixed;
+	long long z_fixed;
+	long long z_offset_fixed;
+	long long z_firmware_offset_fixed;
+	int feature_type_tag;
+	int current_tool;
+	bool f_null;
+	bool x_null;
+	bool x_homed;
+	bool y_null;
+	bool y_homed;
+	bool z_null;
 	bool z_homed;
-	bool is_metric;
-	bool is_metric_null;
+	bool is_arc;
+	bool is_clockwise;
+	bool is_relative;
+	bool is_relative_null;
+	bool is_extruder_relative;
+	bool is_extruder_relative_null;
+	bool has_position_changed;
+	bool has_xy_position_changed;
+	extruder current_extruder;
+	extruder& get_current_extruder();
+	const extruder& get_current_extruder() const;
+	double get_gcode_x() const;
+	double get_gcode_y() const;
+	double get_gcode_z() const;
+	long long get_gcode_x_fixed() const;
+	long long get_gcode_y_fixed() const;
+	long long get_gcode_z_fixed() const;
+	// The XY distance travelled from the previous position, along the arc for G2/G3
+	double get_xy_move_length(const position& previous) const;
+	void set_xyz_axis_mode(const std::string& xyz_axis_default_mode);
+	void set_e_axis_mode(const std::string& e_axis_default_mode);
+};
+
+// The state that only snapshots need: units, layers, heights, priming, z-hop, bounds and file locations.  gcode_position
+// keeps it in a ring parallel to the positions, and doesn't maintain it in motion only mode.
+struct snapshot_state
+{
+	snapshot_state();
+	void reset_state();
+	void set_units_default(const std::string& units_default);
+	bool can_take_snapshot(const position& pos) const;
 	double last_extrusion_height;
-	bool last_extrusion_height_null;
-	long layer;
 	double height;
+	double z_relative;
+	long layer;
 	int height_increment;
 	int height_increment_change_count;
+	long long file_line_number;
+	long long gcode_number;
+	long long file_position;
+	bool last_extrusion_height_null;
+	bool is_metric;
+	bool is_metric_null;
 	bool is_printer_primed;
 	bool has_definite_position;
-	double z_relative;
-	bool is_relative;
-	bool is_relative_null;
-	bool is_extruder_relative;
-	bool is_extruder_relative_null;
 	bool is_layer_change;
 	bool is_height_change;
 	bool is_height_increment_change;
 	bool is_xy_travel;
 	bool is_xyz_travel;
 	bool is_zhop;
-	bool has_position_changed;
-	bool has_xy_position_changed;
 	bool has_received_home_command;
 	bool is_in_position;
 	bool in_path_position;
-	long file_line_number;
-	long gcode_number;
-	long file_position;
 	bool gcode_ignored;
 	bool is_in_bounds;
 	bool is_empty;
-	int current_tool;
-	int num_extruders;
-	bool has_been_deleted;
-	extruder * p_extruders;
-	extruder& get_current_extruder() const;
-	extruder& get_extruder(int index) const;
-	void set_num_extruders(int num_extruders_);
-	void delete_extruders();
-	double get_gcode_x() const;
-	double get_gcode_y() const;
-	double get_gcode_z() const;
-	void set_xyz_axis_mode(const std::string& xyz_axis_default_mode);
-	void set_e_axis_mode(const std::string& e_axis_default_mode);
-	void set_units_default(const std::string& units_default);
-	bool can_take_snapshot();
 };
 #endif
\ No newline at end of file
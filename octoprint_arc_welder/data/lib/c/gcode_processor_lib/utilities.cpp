@@ -25,8 +25,6 @@
 #include <iostream>
 #include <iomanip>
 
-// Had to increase the zero tolerance because prusa slicer doesn't always retract enough while wiping.
-const double ZERO_TOLERANCE = 0.000005;
 const std::string utilities::WHITESPACE_ = " \n\r\t\f\v";
 const char utilities::GUID_RANGE[] = "0123456789abcdef";
 const bool utilities::GUID_DASHES[] = { 0, 0, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0 };
@@ -119,6 +117,39 @@ double utilities::get_cartesian_distance(double x1, double y1, double z1, double
 	return sqrt(dist_squared);
 }
 
+double utilities::get_arc_length(double start_x, double start_y, double end_x, double end_y, double center_x, double center_y, bool is_clockwise)
+{
+	double radius = get_cartesian_distance(start_x, start_y, center_x, center_y);
+	double angle = atan2(end_y - center_y, end_x - center_x) - atan2(start_y - center_y, start_x - center_x);
+	if (is_clockwise)
+		angle = -angle;
+	const double two_pi = 2.0 * 3.14159265358979323846;
+	if (angle < 0)
+		angle += two_pi;
+	if (is_equal(start_x, end_x) && is_equal(start_y, end_y))
+		angle = two_pi;
+	return radius * angle;
+}
+
+void utilities::get_arc_midpoint(double start_x, double start_y, double end_x, double end_y, double center_x, double center_y, bool is_clockwise, double& mid_x, double& mid_y)
+{
+	double angle = atan2(end_y - center_y, end_x - center_x) - atan2(start_y - center_y, start_x - center_x);
+	if (is_clockwise)
+		angle = -angle;
+	const double two_pi = 2.0 * 3.14159265358979323846;
+	if (angle < 0)
+		angle += two_pi;
+	if (is_equal(start_x, end_x) && is_equal(start_y, end_y))
+		angle = two_pi;
+	double half_angle = is_clockwise ? -angle / 2.0 : angle / 2.0;
+	double cos_half = std::cos(half_angle);
+	double sin_half = std::sin(half_angle);
+	double offset_x = start_x - center_x;
+	double offset_y = start_y - center_y;
+	mid_x = center_x + offset_x * cos_half - offset_y * sin_half;
+	mid_y = center_y + offset_x * sin_half + offset_y * cos_half;
+}
+
 std::string utilities::to_string(double value)
 {
 	std::ostringstream os;
@@ -181,6 +212,134 @@ char * utilities::to_string(double value, unsigned short precision, char * str)
 	return str;
 }
 
+long long utilities::to_fixed(double value)
+{
+	// Round half away from zero
+	double scaled = value * static_cast<double>(FIXED_POINT_SCALE);
+	return static_cast<long long>(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+}
+
+double utilities::from_fixed(long long value)
+{
+	return static_cast<double>(value) / static_cast<double>(FIXED_POINT_SCALE);
+}
+
+char * utilities::fixed_to_string(long long value, unsigned short precision, char * str)
+{
+	// Integer only version of to_string for fixed point values.  Unlike to_string, this rounds (half away from zero)
+	// instead of truncating.  The output format is the same:  trailing zeros are removed, but the decimal point is not.
+	if (precision > FIXED_POINT_DIGITS)
+		precision = FIXED_POINT_DIGITS;
+	bool is_negative = value < 0;
+	unsigned long long magnitude = is_negative ? 0ULL - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+	unsigned long long divisor = 1;
+	for (int index = precision; index < FIXED_POINT_DIGITS; index++)
+	{
+		divisor *= 10;
+	}
+	magnitude = (magnitude + divisor / 2) / divisor;
+	unsigned long long precision_scale = 1;
+	for (int index = 0; index < precision; index++)
+	{
+		precision_scale *= 10;
+	}
+	unsigned long long integer_part = magnitude / precision_scale;
+	unsigned long long fractional_part = magnitude % precision_scale;
+
+	int char_count = 0;
+	if (is_negative && magnitude != 0)
+	{
+		str[char_count++] = '-';
+	}
+	char reversed_int[21];
+	int int_count = 0;
+	do
+	{
+		reversed_int[int_count++] = static_cast<char>('0' + integer_part % 10);
+		integer_part /= 10;
+	} while (integer_part > 0);
+	while (int_count > 0)
+	{
+		str[char_count++] = reversed_int[--int_count];
+	}
+	if (precision > 0)
+	{
+		str[char_count++] = '.';
+		while (fractional_part > 0)
+		{
+			precision_scale /= 10;
+			str[char_count++] = static_cast<char>('0' + fractional_part / precision_scale);
+			fractional_part %= precision_scale;
+		}
+	}
+	str[char_count] = 0;
+	return str;
+}
+
+char * utilities::fixed_to_minified_string(long long value, unsigned short precision, long long max_error, char * str)
+{
+	if (precision > FIXED_POINT_DIGITS)
+		precision = FIXED_POINT_DIGITS;
+	bool is_negative = value < 0;
+	unsigned long long magnitude = is_negative ? 0ULL - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+	unsigned long long max_error_magnitude = max_error > 0 ? static_cast<unsigned long long>(max_error) : 0;
+	// Start with the fewest decimals and add one until the rounded value is close enough, or the precision is reached.
+	unsigned long long divisor = FIXED_POINT_SCALE;
+	unsigned short decimals = 0;
+	unsigned long long rounded = (magnitude + divisor / 2) / divisor;
+	while (decimals < precision)
+	{
+		unsigned long long rounded_magnitude = rounded * divisor;
+		unsigned long long error = rounded_magnitude > magnitude ? rounded_magnitude - magnitude : magnitude - rounded_magnitude;
+		if (error <= max_error_magnitude)
+		{
+			break;
+		}
+		decimals++;
+		divisor /= 10;
+		rounded = (magnitude + divisor / 2) / divisor;
+	}
+	unsigned long long precision_scale = 1;
+	for (int index = 0; index < decimals; index++)
+	{
+		precision_scale *= 10;
+	}
+	unsigned long long integer_part = rounded / precision_scale;
+	unsigned long long fractional_part = rounded % precision_scale;
+
+	int char_count = 0;
+	if (is_negative && rounded != 0)
+	{
+		str[char_count++] = '-';
+	}
+	if (integer_part > 0 || fractional_part == 0)
+	{
+		char reversed_int[21];
+		int int_count = 0;
+		do
+		{
+			reversed_int[int_count++] = static_cast<char>('0' + integer_part % 10);
+			integer_part /= 10;
+		} while (integer_part > 0);
+		while (int_count > 0)
+		{
+			str[char_count++] = reversed_int[--int_count];
+		}
+	}
+	if (fractional_part > 0)
+	{
+		str[char_count++] = '.';
+		while (fractional_part > 0)
+		{
+			precision_scale /= 10;
+			str[char_count++] = static_cast<char>('0' + fractional_part / precision_scale);
+			fractional_part %= precision_scale;
+		}
+	}
+	str[char_count] = 0;
+	return str;
+}
+
 std::string utilities::ltrim(const std::string& s)
 {
 	size_t start = s.find_first_not_of(WHITESPACE_);
@@ -243,7 +402,7 @@ std::string utilities::center(std::string input, int width)
 	return std::string(left_padding, ' ') + input + std::string(right_padding, ' ');
 }
 
-std::string utilities::get_percent_change_string(int v1, int v2, int precision)
+std::string utilities::get_percent_change_string(long long v1, long long v2, int precision)
 {
 	std::stringstream format_stream;
 	format_stream.str(std::string());
@@ -282,6 +441,19 @@ int utilities::get_num_digits(int x)
 										10)))))))));
 }
 
+int utilities::get_num_digits(long long x)
+{
+	if (x < 0)
+		x = -x;
+	int num_digits = 1;
+	while (x >= 10)
+	{
+		x /= 10;
+		num_digits++;
+	}
+	return num_digits;
+}
+
 int utilities::get_num_digits(double x)
 {
 	return get_num_digits((int) x);
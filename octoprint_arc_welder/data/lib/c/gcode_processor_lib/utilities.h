@@ -24,6 +24,13 @@
 #include <string>
 #include <vector>
 #include <set>
+// Fixed point values are stored as 64 bit integers in nanometers (9 decimal places)
+#define FIXED_POINT_DIGITS 9
+#define FIXED_POINT_SCALE 1000000000LL
+// Integer parts at or above this can't be represented in fixed point without overflowing
+#define FIXED_POINT_MAX_INTEGER 1000000000LL
+// Had to increase the zero tolerance because prusa slicer doesn't always retract enough while wiping.
+const double ZERO_TOLERANCE = 0.000005;
 class utilities{
 public:
 	static bool is_zero(double x);
@@ -45,17 +52,29 @@ public:
 
 	static double get_cartesian_distance(double x1, double y1, double x2, double y2);
 	static double get_cartesian_distance(double x1, double y1, double z1, double x2, double y2, double z2);
+	// The length of an arc around the center from the start to the end point.  The radius is the distance from the
+	// start point to the center, and an arc that ends where it starts is a full circle.
+	static double get_arc_length(double start_x, double start_y, double end_x, double end_y, double center_x, double center_y, bool is_clockwise);
+	// The point half way along the same arc
+	static void get_arc_midpoint(double start_x, double start_y, double end_x, double end_y, double center_x, double center_y, bool is_clockwise, double& mid_x, double& mid_y);
 	static std::string to_string(double value);
 	static std::string to_string(int value);
 	static char* to_string(double value, unsigned short precision, char* str);
+	static long long to_fixed(double value);
+	static double from_fixed(long long value);
+	static char* fixed_to_string(long long value, unsigned short precision, char* str);
+	// Writes the fewest decimals (up to precision) that keep the value within max_error of the exact value, both in
+	// fixed point.  There is no leading zero, trailing zero or trailing decimal point (.5, -.25, 10).
+	static char* fixed_to_minified_string(long long value, unsigned short precision, long long max_error, char* str);
 	static std::string ltrim(const std::string& s);
 	static std::string rtrim(const std::string& s);
 	static std::string trim(const std::string& s);
 	static std::istream& safe_get_line(std::istream& is, std::string& t);
 	static std::string center(std::string input, int width);
-	static std::string get_percent_change_string(int v1, int v2, int precision);
+	static std::string get_percent_change_string(long long v1, long long v2, int precision);
 
 	static int get_num_digits(int x);
+	static int get_num_digits(long long x);
 	static int get_num_digits(double x);
 
 	static std::vector<std::string> splitpath(const std::string& str);
@@ -28,7 +28,11 @@ PyObject* py_arc_welder::build_py_progress(const arc_welder_progress& progress)
 	PyObject* pyMessage = gcode_arc_converter::PyUnicode_SafeFromString(segment_statistics);
 	if (pyMessage == NULL)
 		return NULL;
-	PyObject* py_progress = Py_BuildValue("{s:d,s:d,s:d,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:f,s:f,s:f,s:f,s:i,s:i}",
+	std::string shape_statistics = progress.shape_statistics.str();
+	PyObject* pyShapeMessage = gcode_arc_converter::PyUnicode_SafeFromString(shape_statistics);
+	if (pyShapeMessage == NULL)
+		return NULL;
+	PyObject* py_progress = Py_BuildValue("{s:d,s:d,s:d,s:L,s:L,s:L,s:L,s:L,s:L,s:L,s:f,s:f,s:f,s:f,s:L,s:L,s:L,s:d,s:L,s:L,s:L,s:L,s:L,s:L,s:L,s:L,s:L,s:L,s:L}",
 		"percent_complete",
 		progress.percent_complete,												//1
 		"seconds_elapsed",
@@ -60,7 +64,33 @@ PyObject* py_arc_welder::build_py_progress(const arc_welder_progress& progress)
 		"source_file_total_count",
 		progress.segment_statistics.total_count_source,		//15
 		"target_file_total_count",
-		progress.segment_statistics.total_length_target	//16
+		progress.segment_statistics.total_count_target,		//16
+		"fit_validations",
+		progress.fit_validations,													//17
+		"fit_seconds",
+		progress.fit_seconds,															//18
+		"lines_simplified",
+		progress.lines_simplified,												//19
+		"line_points_compressed",
+		progress.line_points_compressed,										//20
+		"redundant_moves_removed",
+		progress.redundant_moves_removed,									//21
+		"redundant_feedrates_removed",
+		progress.redundant_feedrates_removed,							//22
+		"redundant_axes_removed",
+		progress.redundant_axes_removed,									//23
+		"redundant_fan_commands_removed",
+		progress.redundant_fan_commands_removed,					//24
+		"redundant_g92_commands_removed",
+		progress.redundant_g92_commands_removed,					//25
+		"r_arcs_written",
+		progress.r_arcs_written,													//26
+		"r_arc_bytes_saved",
+		progress.r_arc_bytes_saved,												//27
+		"curves_created",
+		progress.curves_created,													//28
+		"curve_points_compressed",
+		progress.curve_points_compressed									//29
 	);
 
 	if (py_progress == NULL)
@@ -71,6 +101,7 @@ PyObject* py_arc_welder::build_py_progress(const arc_welder_progress& progress)
 	// else it crashes in python 2.7.  Looking forward to retiring this backwards 
 	// compatible code...
 	PyDict_SetItemString(py_progress, "segment_statistics_text", pyMessage);
+	PyDict_SetItemString(py_progress, "shape_statistics_text", pyShapeMessage);
 	return py_progress;
 }
 
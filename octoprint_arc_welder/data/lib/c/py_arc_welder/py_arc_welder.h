@@ -34,7 +34,7 @@
 class py_arc_welder : public arc_welder
 {
 public:
-	py_arc_welder(std::string source_path, std::string target_path, py_logger* logger, double resolution_mm, double max_radius, bool g90_g91_influences_extruder, int buffer_size, PyObject* py_progress_callback):arc_welder(source_path, target_path, logger, resolution_mm, max_radius, g90_g91_influences_extruder, buffer_size)
+	py_arc_welder(arc_welder_args args, PyObject* py_progress_callback):arc_welder(args)
 	{
 		py_progress_callback_ = py_progress_callback;
 	}
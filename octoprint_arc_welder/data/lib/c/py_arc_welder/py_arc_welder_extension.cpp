@@ -184,13 +184,36 @@ extern "C"
 		{
 			return NULL;
 		}
-		p_py_logger->set_log_level_by_value(args.log_level);
+		// ParseArgs has already converted the log level value into a log level
+		p_py_logger->set_log_level(args.log_level);
 		
 
 		std::string message = "py_gcode_arc_converter.ConvertFile - Beginning Arc Conversion.";
 		p_py_logger->log(GCODE_CONVERSION, INFO, message);
 
-		py_arc_welder arc_welder_obj(args.source_file_path, args.target_file_path, p_py_logger, args.resolution_mm, args.max_radius_mm, args.g90_g91_influences_extruder, 50, py_progress_callback);
+		arc_welder_args welder_args;
+		welder_args.source_path = args.source_file_path;
+		welder_args.target_path = args.target_file_path;
+		welder_args.log = p_py_logger;
+		welder_args.resolution_mm = args.resolution_mm;
+		welder_args.max_radius_mm = args.max_radius_mm;
+		welder_args.g90_g91_influences_extruder = args.g90_g91_influences_extruder;
+		welder_args.use_fixed_point = args.use_fixed_point;
+		welder_args.use_least_squares_fit = args.use_least_squares_fit;
+		welder_args.use_lookahead = args.use_lookahead;
+		welder_args.use_segment_optimizer = args.use_segment_optimizer;
+		welder_args.allow_helical_arcs = args.allow_helical_arcs;
+		welder_args.allow_travel_arcs = args.allow_travel_arcs;
+		welder_args.allow_g0_travel_arcs = args.allow_g0_travel_arcs;
+		welder_args.use_line_simplification = args.use_line_simplification;
+		welder_args.remove_redundant_commands = args.remove_redundant_commands;
+		welder_args.minify_gcode = args.minify_gcode;
+		welder_args.minify_gcode_remove_spaces = args.minify_gcode_remove_spaces;
+		welder_args.allow_r_arcs = args.allow_r_arcs;
+		welder_args.allow_bezier_curves = args.allow_bezier_curves;
+		welder_args.min_segments = args.min_segments;
+		welder_args.max_segments = args.max_segments;
+		py_arc_welder arc_welder_obj(welder_args, py_progress_callback);
 		arc_welder_results results = arc_welder_obj.process();
 		message = "py_gcode_arc_converter.ConvertFile - Arc Conversion Complete.";
 		p_py_logger->log(GCODE_CONVERSION, INFO, message);
@@ -281,6 +304,123 @@ static bool ParseArgs(PyObject* py_args, py_gcode_arc_args& args, PyObject** py_
 	}
 	args.g90_g91_influences_extruder = PyLong_AsLong(py_g90_g91_influences_extruder) > 0;
 
+	// Extract use_fixed_point.  This one is optional.
+	PyObject* py_use_fixed_point = PyDict_GetItemString(py_args, "use_fixed_point");
+	if (py_use_fixed_point != NULL)
+	{
+		args.use_fixed_point = PyLong_AsLong(py_use_fixed_point) > 0;
+	}
+
+	// Extract use_least_squares_fit.  This one is optional.
+	PyObject* py_use_least_squares_fit = PyDict_GetItemString(py_args, "use_least_squares_fit");
+	if (py_use_least_squares_fit != NULL)
+	{
+		args.use_least_squares_fit = PyLong_AsLong(py_use_least_squares_fit) > 0;
+	}
+
+	// Extract use_lookahead.  This one is optional.
+	PyObject* py_use_lookahead = PyDict_GetItemString(py_args, "use_lookahead");
+	if (py_use_lookahead != NULL)
+	{
+		args.use_lookahead = PyLong_AsLong(py_use_lookahead) > 0;
+	}
+
+	// Extract use_segment_optimizer.  This one is optional.
+	PyObject* py_use_segment_optimizer = PyDict_GetItemString(py_args, "use_segment_optimizer");
+	if (py_use_segment_optimizer != NULL)
+	{
+		args.use_segment_optimizer = PyLong_AsLong(py_use_segment_optimizer) > 0;
+	}
+
+	// Extract allow_helical_arcs.  This one is optional.
+	PyObject* py_allow_helical_arcs = PyDict_GetItemString(py_args, "allow_helical_arcs");
+	if (py_allow_helical_arcs != NULL)
+	{
+		args.allow_helical_arcs = PyLong_AsLong(py_allow_helical_arcs) > 0;
+	}
+
+	// Extract allow_travel_arcs.  This one is optional.
+	PyObject* py_allow_travel_arcs = PyDict_GetItemString(py_args, "allow_travel_arcs");
+	if (py_allow_travel_arcs != NULL)
+	{
+		args.allow_travel_arcs = PyLong_AsLong(py_allow_travel_arcs) > 0;
+	}
+
+	// Extract allow_g0_travel_arcs.  This one is optional.
+	PyObject* py_allow_g0_travel_arcs = PyDict_GetItemString(py_args, "allow_g0_travel_arcs");
+	if (py_allow_g0_travel_arcs != NULL)
+	{
+		args.allow_g0_travel_arcs = PyLong_AsLong(py_allow_g0_travel_arcs) > 0;
+	}
+
+	// Extract use_line_simplification.  This one is optional.
+	PyObject* py_use_line_simplification = PyDict_GetItemString(py_args, "use_line_simplification");
+	if (py_use_line_simplification != NULL)
+	{
+		args.use_line_simplification = PyLong_AsLong(py_use_line_simplification) > 0;
+	}
+
+	// Extract remove_redundant_commands.  This one is optional.
+	PyObject* py_remove_redundant_commands = PyDict_GetItemString(py_args, "remove_redundant_commands");
+	if (py_remove_redundant_commands != NULL)
+	{
+		args.remove_redundant_commands = PyLong_AsLong(py_remove_redundant_commands) > 0;
+	}
+
+	// Extract minify_gcode.  This one is optional.
+	PyObject* py_minify_gcode = PyDict_GetItemString(py_args, "minify_gcode");
+	if (py_minify_gcode != NULL)
+	{
+		args.minify_gcode = PyLong_AsLong(py_minify_gcode) > 0;
+	}
+
+	// Extract minify_gcode_remove_spaces.  This one is optional.
+	PyObject* py_minify_gcode_remove_spaces = PyDict_GetItemString(py_args, "minify_gcode_remove_spaces");
+	if (py_minify_gcode_remove_spaces != NULL)
+	{
+		args.minify_gcode_remove_spaces = PyLong_AsLong(py_minify_gcode_remove_spaces) > 0;
+	}
+
+	// Extract allow_r_arcs.  This one is optional.
+	PyObject* py_allow_r_arcs = PyDict_GetItemString(py_args, "allow_r_arcs");
+	if (py_allow_r_arcs != NULL)
+	{
+		args.allow_r_arcs = PyLong_AsLong(py_allow_r_arcs) > 0;
+	}
+
+	// Extract allow_bezier_curves.  This one is optional.
+	PyObject* py_allow_bezier_curves = PyDict_GetItemString(py_args, "allow_bezier_curves");
+	if (py_allow_bezier_curves != NULL)
+	{
+		args.allow_bezier_curves = PyLong_AsLong(py_allow_bezier_curves) > 0;
+	}
+
+	// Extract min_segments.  This one is optional.
+	PyObject* py_min_segments = PyDict_GetItemString(py_args, "min_segments");
+	if (py_min_segments != NULL)
+	{
+		args.min_segments = PyLong_AsLong(py_min_segments);
+		if (args.min_segments < DEFAULT_MIN_SEGMENTS)
+		{
+			args.min_segments = DEFAULT_MIN_SEGMENTS; // An arc needs at least 3 points.
+		}
+	}
+
+	// Extract max_segments.  This one is optional.
+	PyObject* py_max_segments = PyDict_GetItemString(py_args, "max_segments");
+	if (py_max_segments != NULL)
+	{
+		args.max_segments = PyLong_AsLong(py_max_segments);
+	}
+	if (args.max_segments > MAX_ARC_SEGMENTS_LIMIT)
+	{
+		args.max_segments = MAX_ARC_SEGMENTS_LIMIT;
+	}
+	if (args.max_segments < args.min_segments)
+	{
+		args.max_segments = args.min_segments;
+	}
+
 	// on_progress_received
 	PyObject* py_on_progress_received = PyDict_GetItemString(py_args, "on_progress_received");
 	if (py_on_progress_received == NULL)
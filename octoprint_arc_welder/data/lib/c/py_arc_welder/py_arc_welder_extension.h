@@ -48,6 +48,21 @@ struct py_gcode_arc_args {
 		resolution_mm = DEFAULT_RESOLUTION_MM;
 		max_radius_mm = DEFAULT_MAX_RADIUS_MM;
 		g90_g91_influences_extruder = DEFAULT_G90_G91_INFLUENCES_EXTREUDER;
+		use_fixed_point = DEFAULT_USE_FIXED_POINT;
+		use_least_squares_fit = DEFAULT_USE_LEAST_SQUARES_FIT;
+		use_lookahead = DEFAULT_USE_LOOKAHEAD;
+		use_segment_optimizer = DEFAULT_USE_SEGMENT_OPTIMIZER;
+		allow_helical_arcs = DEFAULT_ALLOW_HELICAL_ARCS;
+		allow_travel_arcs = DEFAULT_ALLOW_TRAVEL_ARCS;
+		allow_g0_travel_arcs = DEFAULT_ALLOW_G0_TRAVEL_ARCS;
+		use_line_simplification = DEFAULT_USE_LINE_SIMPLIFICATION;
+		remove_redundant_commands = DEFAULT_REMOVE_REDUNDANT_COMMANDS;
+		minify_gcode = DEFAULT_MINIFY_GCODE;
+		minify_gcode_remove_spaces = DEFAULT_MINIFY_GCODE_REMOVE_SPACES;
+		allow_r_arcs = DEFAULT_ALLOW_R_ARCS;
+		allow_bezier_curves = DEFAULT_ALLOW_BEZIER_CURVES;
+		min_segments = DEFAULT_MIN_SEGMENTS;
+		max_segments = DEFAULT_MAX_ARC_SEGMENTS;
 		log_level = 0;
 	}
 	py_gcode_arc_args(std::string source_file_path_, std::string target_file_path_, double resolution_mm_, double max_radius_mm_, bool g90_g91_influences_extruder_, int log_level_) {
@@ -56,12 +71,42 @@ struct py_gcode_arc_args {
 		resolution_mm = resolution_mm_;
 		max_radius_mm = max_radius_mm_;
 		g90_g91_influences_extruder = g90_g91_influences_extruder_;
+		use_fixed_point = DEFAULT_USE_FIXED_POINT;
+		use_least_squares_fit = DEFAULT_USE_LEAST_SQUARES_FIT;
+		use_lookahead = DEFAULT_USE_LOOKAHEAD;
+		use_segment_optimizer = DEFAULT_USE_SEGMENT_OPTIMIZER;
+		allow_helical_arcs = DEFAULT_ALLOW_HELICAL_ARCS;
+		allow_travel_arcs = DEFAULT_ALLOW_TRAVEL_ARCS;
+		allow_g0_travel_arcs = DEFAULT_ALLOW_G0_TRAVEL_ARCS;
+		use_line_simplification = DEFAULT_USE_LINE_SIMPLIFICATION;
+		remove_redundant_commands = DEFAULT_REMOVE_REDUNDANT_COMMANDS;
+		minify_gcode = DEFAULT_MINIFY_GCODE;
+		minify_gcode_remove_spaces = DEFAULT_MINIFY_GCODE_REMOVE_SPACES;
+		allow_r_arcs = DEFAULT_ALLOW_R_ARCS;
+		allow_bezier_curves = DEFAULT_ALLOW_BEZIER_CURVES;
+		min_segments = DEFAULT_MIN_SEGMENTS;
+		max_segments = DEFAULT_MAX_ARC_SEGMENTS;
 		log_level = log_level_;
 	}
 	std::string source_file_path;
 	std::string target_file_path;
 	double resolution_mm;
 	bool g90_g91_influences_extruder;
+	bool use_fixed_point;
+	bool use_least_squares_fit;
+	bool use_lookahead;
+	bool use_segment_optimizer;
+	bool allow_helical_arcs;
+	bool allow_travel_arcs;
+	bool allow_g0_travel_arcs;
+	bool use_line_simplification;
+	bool remove_redundant_commands;
+	bool minify_gcode;
+	bool minify_gcode_remove_spaces;
+	bool allow_r_arcs;
+	bool allow_bezier_curves;
+	int min_segments;
+	int max_segments;
 	double max_radius_mm;
 	int log_level;
 };
@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Gcode Processor Library
+//
+// Tools for parsing gcode and calculating printer state from parsed gcode commands.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address:
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Differential test of the canonical G0/G1 fast path.  Every line is parsed by try_parse_gcode (fast path first) and by
+// try_parse_gcode_general (general parser only), in both preserve_format modes, and the parsed commands must be the
+// same down to the bits of every value.  The lines come from the gcode files given on the command line, plus a built
+// in list of lines that are just on either side of what the fast path accepts.
+//
+// Usage: gcode_parser_test [file.gcode ...]
+#include "gcode_parser.h"
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+static const char* edge_lines[] = {
+	"G1 X10 Y20 E0.5",
+	"G1 X10.000 Y20.000 E0.50000 F1800",
+	"G0 X-1.5 Y-.5 Z0.2",
+	"G1 X1.5Y2.5",
+	"G1  X1 Y2",
+	"G1 X1 Y2 ",
+	"G1 X1 Y2\t",
+	"G1 X1 Y2 ; comment",
+	"G1 X1 Y2;comment",
+	"G1 x1 y2",
+	"g1 X1 Y2",
+	"G1 X1 Y2 I3",
+	"G1 X1 X2",
+	"G1 X Y2",
+	"G1 X- Y2",
+	"G1 X1. Y2.",
+	"G1 X+1 Y2",
+	"G1 X1e3 Y2",
+	"G1 X9999999999 Y1",
+	"G1 X999999999.999999999 Y1",
+	"G1 X0.0000000001 Y1",
+	"G1 X1.1234567891234 Y1",
+	"G1 X1 Y2 Z3 E4 F5 X6 Y7 Z8 E9",
+	"G1 X1 Y2 Z3 E4 F5 X6 Y7 Z8",
+	"G10",
+	"G11",
+	"G1",
+	"G0",
+	"G1 ",
+	"G1;",
+	"G01 X1 Y2",
+	"G1 F",
+	"G1 E-0.8 F2100",
+	"G2 X1 Y2 I3 J4 E5",
+	"M106 S255",
+	"T0",
+	"; only a comment",
+	"",
+	"   ",
+	"G1 X1 Y2\r",
+};
+
+static std::string describe(const parsed_command& command)
+{
+	std::stringstream stream;
+	stream << "command='" << command.command << "' gcode='" << command.gcode << "' comment='" << command.comment
+		<< "' is_empty=" << command.is_empty << " is_known_command=" << command.is_known_command;
+	for (unsigned int index = 0; index < command.parameters.size(); index++)
+	{
+		const parsed_command_parameter& parameter = command.parameters[index];
+		stream << " [" << parameter.name << " " << parameter.value_type;
+		if (parameter.value_type == 'F')
+		{
+			stream << " " << std::setprecision(17) << parameter.double_value << " fixed=" << parameter.fixed_value
+				<< " has_fixed=" << parameter.has_fixed_value;
+		}
+		else if (parameter.value_type == 'U')
+			stream << " " << parameter.unsigned_long_value;
+		else if (parameter.value_type == 'S')
+			stream << " '" << parameter.string_value << "'";
+		stream << "]";
+	}
+	return stream.str();
+}
+
+static bool are_parameters_equal(const parsed_command_parameter& a, const parsed_command_parameter& b)
+{
+	if (a.name != b.name || a.value_type != b.value_type)
+		return false;
+	switch (a.value_type)
+	{
+	case 'F':
+		// Compare the bits, the values must be identical and not just close
+		return memcmp(&a.double_value, &b.double_value, sizeof(double)) == 0 &&
+			a.fixed_value == b.fixed_value && a.has_fixed_value == b.has_fixed_value;
+	case 'U':
+		return a.unsigned_long_value == b.unsigned_long_value;
+	case 'S':
+		return a.string_value == b.string_value;
+	default:
+		return true;
+	}
+}
+
+static bool are_commands_equal(const parsed_command& a, const parsed_command& b)
+{
+	if (
+		a.command != b.command || a.gcode != b.gcode || a.comment != b.comment ||
+		a.is_empty != b.is_empty || a.is_known_command != b.is_known_command ||
+		a.parameters.size() != b.parameters.size()
+	)
+		return false;
+	for (unsigned int index = 0; index < a.parameters.size(); index++)
+	{
+		if (!are_parameters_equal(a.parameters[index], b.parameters[index]))
+			return false;
+	}
+	return true;
+}
+
+static int num_lines = 0;
+static int num_failures = 0;
+
+static void check_line(gcode_parser& parser, const std::string& line, const std::string& source)
+{
+	num_lines++;
+	for (int preserve_format = 0; preserve_format < 2; preserve_format++)
+	{
+		parsed_command fast;
+		parsed_command general;
+		bool fast_result = parser.try_parse_gcode(line.c_str(), fast, preserve_format == 1);
+		bool general_result = parser.try_parse_gcode_general(line.c_str(), general, preserve_format == 1);
+		if (fast_result != general_result || !are_commands_equal(fast, general))
+		{
+			num_failures++;
+			std::cout << "FAIL " << source << " (preserve_format=" << preserve_format << "): '" << line << "'\n"
+				<< "  try_parse_gcode:         " << describe(fast) << "\n"
+				<< "  try_parse_gcode_general: " << describe(general) << "\n";
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	gcode_parser parser;
+	for (unsigned int index = 0; index < sizeof(edge_lines) / sizeof(edge_lines[0]); index++)
+	{
+		check_line(parser, edge_lines[index], "edge lines");
+	}
+	for (int index = 1; index < argc; index++)
+	{
+		std::ifstream file(argv[index]);
+		if (!file.is_open())
+		{
+			std::cout << "FAIL could not open " << argv[index] << "\n";
+			return 1;
+		}
+		std::string line;
+		int line_number = 0;
+		while (std::getline(file, line))
+		{
+			line_number++;
+			std::stringstream source;
+			source << argv[index] << ":" << line_number;
+			check_line(parser, line, source.str());
+		}
+	}
+	std::cout << num_lines << " lines checked, " << num_failures << " differences\n";
+	return num_failures == 0 ? 0 : 1;
+}
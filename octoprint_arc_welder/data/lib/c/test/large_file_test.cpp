@@ -0,0 +1,276 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address:
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Checks the 64 bit counters, file positions, percentages and ETA on a synthetic file larger than 4GB.  The file
+// repeats one block (a polygon that becomes arcs, then a few straight lines) with relative extrusion, so every block
+// gives the same output.  Files of 2 and 3 blocks give the exact counts per block, and the large file must match
+// them scaled up.  Nothing that would wrap at 2^31 or 2^32 may do so.
+//
+// The source and target take several GB, so the test only runs when ARC_WELDER_LARGE_FILE_TEST_GB is set to the source
+// size in GB.  The files go in ARC_WELDER_LARGE_FILE_TEST_DIR (default /tmp) and are deleted afterwards.  Gcode file arguments are
+// ignored.
+#include "arc_welder.h"
+#include "logger.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char* header = "G21\nG90\nM83\nG1 F1800\n";
+
+static std::string get_block()
+{
+	std::stringstream block;
+	char line[100];
+	const int num_segments = 72;
+	const double radius = 20.0;
+	sprintf(line, "G0 X%.3f Y%.3f\n", 100.0 + radius, 100.0);
+	block << line;
+	for (int index = 1; index <= num_segments; index++)
+	{
+		double angle = 2.0 * 3.14159265358979323846 * index / num_segments;
+		sprintf(line, "G1 X%.3f Y%.3f E0.06981\n", 100.0 + radius * std::cos(angle), 100.0 + radius * std::sin(angle));
+		block << line;
+	}
+	block << "G1 X130.000 Y100.000 E0.33260\nG1 X130.000 Y130.000 E0.99780\nG1 X100.000 Y130.000 E0.99780\n";
+	block << "; a comment line\nM106 S255\n";
+	return block.str();
+}
+
+static long long write_file(const std::string& path, long long num_blocks)
+{
+	std::ofstream file(path.c_str(), std::ios::binary);
+	std::string block = get_block();
+	file << header;
+	for (long long index = 0; index < num_blocks; index++)
+	{
+		file.write(block.c_str(), static_cast<std::streamsize>(block.length()));
+	}
+	file.close();
+	return static_cast<long long>(strlen(header)) + num_blocks * static_cast<long long>(block.length());
+}
+
+static long long get_file_size(const std::string& path)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	return static_cast<long long>(file.tellg());
+}
+
+// Everything the progress callbacks of one run reported
+struct progress_log
+{
+	progress_log()
+	{
+		num_updates = 0;
+		max_source_file_position = 0;
+		max_target_file_size = 0;
+		previous_percent_complete = 0;
+		previous_source_file_position = 0;
+	}
+	long long num_updates;
+	long long max_source_file_position;
+	long long max_target_file_size;
+	double previous_percent_complete;
+	long long previous_source_file_position;
+};
+
+static progress_log current_log;
+static int num_failures = 0;
+
+static void fail(const std::string& message)
+{
+	num_failures++;
+	std::cout << "FAIL " << message << "\n";
+}
+
+static bool on_progress(arc_welder_progress progress, logger* /*p_logger*/, int /*logger_type*/)
+{
+	current_log.num_updates++;
+	if (progress.source_file_position < current_log.previous_source_file_position || progress.source_file_position > progress.source_file_size)
+	{
+		std::stringstream message;
+		message << "source_file_position " << progress.source_file_position << " after " << current_log.previous_source_file_position << " of " << progress.source_file_size;
+		fail(message.str());
+	}
+	if (!(progress.percent_complete >= current_log.previous_percent_complete && progress.percent_complete <= 100.0))
+	{
+		std::stringstream message;
+		message << "percent_complete " << progress.percent_complete << " after " << current_log.previous_percent_complete;
+		fail(message.str());
+	}
+	if (progress.seconds_elapsed > 0 && !(progress.seconds_remaining >= 0 && std::isfinite(progress.seconds_remaining)))
+	{
+		std::stringstream message;
+		message << "seconds_remaining " << progress.seconds_remaining << " at " << progress.percent_complete << "%";
+		fail(message.str());
+	}
+	if (progress.target_file_size < 0 || progress.target_file_size < current_log.max_target_file_size)
+	{
+		std::stringstream message;
+		message << "target_file_size " << progress.target_file_size << " after " << current_log.max_target_file_size;
+		fail(message.str());
+	}
+	current_log.previous_percent_complete = progress.percent_complete;
+	current_log.previous_source_file_position = progress.source_file_position;
+	if (progress.source_file_position > current_log.max_source_file_position)
+		current_log.max_source_file_position = progress.source_file_position;
+	if (progress.target_file_size > current_log.max_target_file_size)
+		current_log.max_target_file_size = progress.target_file_size;
+	return true;
+}
+
+static arc_welder_progress process(const std::string& source_path, const std::string& target_path)
+{
+	std::vector<std::string> logger_names;
+	logger_names.push_back("arc_welder.large_file_test");
+	std::vector<int> logger_levels;
+	logger_levels.push_back(WARNING);
+	logger log(logger_names, logger_levels);
+	log.set_log_level(WARNING);
+	arc_welder_args args;
+	args.source_path = source_path;
+	args.target_path = target_path;
+	args.log = &log;
+	args.callback = on_progress;
+	arc_welder welder(args);
+	current_log = progress_log();
+	arc_welder_results results = welder.process();
+	if (!results.success)
+	{
+		fail("processing " + source_path + " failed: " + results.message);
+	}
+	return results.progress;
+}
+
+// The value for num_blocks, given the values for 2 and 3 blocks
+static long long extrapolate(long long value_2, long long value_3, long long num_blocks)
+{
+	return value_2 + (num_blocks - 2) * (value_3 - value_2);
+}
+
+static void check_count(const char* name, long long actual, long long value_2, long long value_3, long long num_blocks)
+{
+	long long expected = extrapolate(value_2, value_3, num_blocks);
+	std::cout << "  " << name << " = " << actual;
+	if (actual != expected)
+	{
+		std::cout << "\n";
+		std::stringstream message;
+		message << name << " is " << actual << ", expected " << expected;
+		fail(message.str());
+		return;
+	}
+	std::cout << " (as expected)\n";
+}
+
+int main()
+{
+	const char* size_gb_text = getenv("ARC_WELDER_LARGE_FILE_TEST_GB");
+	if (size_gb_text == NULL)
+	{
+		std::cout << "skipped, set ARC_WELDER_LARGE_FILE_TEST_GB to the source size in GB (for example 4.5) to run it\n";
+		return 0;
+	}
+	const char* dir_text = getenv("ARC_WELDER_LARGE_FILE_TEST_DIR");
+	std::string dir = dir_text != NULL ? dir_text : "/tmp";
+	std::string source_path = dir + "/arc_welder_large_file_test_source.gcode";
+	std::string target_path = dir + "/arc_welder_large_file_test_target.gcode";
+
+	// The exact results for 2 and 3 blocks
+	write_file(source_path, 2);
+	arc_welder_progress progress_2 = process(source_path, target_path);
+	long long target_size_2 = get_file_size(target_path);
+	write_file(source_path, 3);
+	arc_welder_progress progress_3 = process(source_path, target_path);
+	long long target_size_3 = get_file_size(target_path);
+
+	double size_gb = atof(size_gb_text);
+	long long block_length = static_cast<long long>(get_block().length());
+	long long num_blocks = static_cast<long long>(size_gb * 1024 * 1024 * 1024) / block_length + 1;
+	std::cout << "Writing " << num_blocks << " blocks to " << source_path << "\n";
+	long long source_size = write_file(source_path, num_blocks);
+	if (get_file_size(source_path) != source_size)
+	{
+		std::cout << "FAIL could not write " << source_size << " bytes to " << source_path << "\n";
+		remove(source_path.c_str());
+		return 1;
+	}
+	std::cout << "Processing " << source_size << " bytes\n";
+	arc_welder_progress progress = process(source_path, target_path);
+	long long target_size = get_file_size(target_path);
+	remove(source_path.c_str());
+	remove(target_path.c_str());
+
+	std::cout << "  progress updates = " << current_log.num_updates << ", largest source_file_position = " << current_log.max_source_file_position << "\n";
+	if (source_size <= 0xFFFFFFFFLL)
+	{
+		fail("the source is not larger than 4GB, so nothing would wrap");
+	}
+	if (progress.source_file_size != source_size)
+	{
+		std::stringstream message;
+		message << "source_file_size is " << progress.source_file_size << ", expected " << source_size;
+		fail(message.str());
+	}
+	if (progress.source_file_position != source_size || progress.percent_complete != 100.0)
+	{
+		std::stringstream message;
+		message << "the final progress is at " << progress.source_file_position << " (" << progress.percent_complete << "%)";
+		fail(message.str());
+	}
+	if (current_log.max_source_file_position <= 0x7FFFFFFFLL)
+	{
+		fail("no progress update was sent past 2^31 bytes");
+	}
+	if (progress.target_file_size != target_size)
+	{
+		std::stringstream message;
+		message << "target_file_size is " << progress.target_file_size << ", the file has " << target_size;
+		fail(message.str());
+	}
+	double compression_ratio = static_cast<double>(source_size) / static_cast<double>(target_size);
+	if (std::abs(progress.compression_ratio - compression_ratio) > 1e-9 * compression_ratio)
+	{
+		std::stringstream message;
+		message << "compression_ratio is " << progress.compression_ratio << ", expected " << compression_ratio;
+		fail(message.str());
+	}
+	check_count("target file size", target_size, target_size_2, target_size_3, num_blocks);
+	check_count("lines_processed", progress.lines_processed, progress_2.lines_processed, progress_3.lines_processed, num_blocks);
+	check_count("gcodes_processed", progress.gcodes_processed, progress_2.gcodes_processed, progress_3.gcodes_processed, num_blocks);
+	check_count("arcs_created", progress.arcs_created, progress_2.arcs_created, progress_3.arcs_created, num_blocks);
+	check_count("points_compressed", progress.points_compressed, progress_2.points_compressed, progress_3.points_compressed, num_blocks);
+	check_count("fit_validations", progress.fit_validations, progress_2.fit_validations, progress_3.fit_validations, num_blocks);
+	check_count("source segments", progress.segment_statistics.total_count_source, progress_2.segment_statistics.total_count_source, progress_3.segment_statistics.total_count_source, num_blocks);
+	check_count("target segments", progress.segment_statistics.total_count_target, progress_2.segment_statistics.total_count_target, progress_3.segment_statistics.total_count_target, num_blocks);
+
+	std::cout << (num_failures == 0 ? "large file test passed\n" : "large file test failed\n");
+	return num_failures == 0 ? 0 : 1;
+}
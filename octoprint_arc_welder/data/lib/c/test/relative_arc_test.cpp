@@ -0,0 +1,422 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Arc Welder: Anti-Stutter Library
+//
+// Compresses many G0/G1 commands into G2/G3(arc) commands where possible, ensuring the tool paths stay within the specified resolution.
+// This reduces file size and the number of gcodes per second.
+//
+// Uses the 'Gcode Processor Library' for gcode parsing, position processing, logging, and other various functionality.
+//
+// Copyright(C) 2020 - Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+//
+// You can contact the author at the following email address:
+// FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Round trip test of arcs welded in relative (G91) XYZ mode.  Each source is rewritten so that every move after the
+// position is known is relative, and the relative file is welded.  The welded output is then replayed through
+// gcode_position, and the absolute end point of every move must be one of the source's end points, in order, with the
+// same final position.
+//
+// The sources are a built in file of polygons, plus the gcode files given on the command line.
+//
+// Usage: relative_arc_test [file.gcode ...]
+#include "arc_welder.h"
+#include "gcode_parser.h"
+#include "gcode_position.h"
+#include "logger.h"
+#include "utilities.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// XYZ must match within this distance for moves in relative mode.  Relative arc end points are written with every
+// digit, so they are exact.  E is not compared, it follows M82/M83 whatever the XYZ mode, and relative E is rounded to
+// 5 decimals for each arc.
+#define RELATIVE_ARC_TEST_TOLERANCE 0.000001
+// Absolute arc end points are written with 3 decimals, which is fine as long as no relative move follows from them
+#define RELATIVE_ARC_TEST_ABSOLUTE_TOLERANCE 0.0011
+
+struct end_point
+{
+	double x;
+	double y;
+	double z;
+	bool is_relative;
+	long long line_number;
+};
+
+static int num_failures = 0;
+
+static void fail(const std::string& message)
+{
+	num_failures++;
+	std::cout << "FAIL " << message << "\n";
+}
+
+static gcode_position_args get_position_args()
+{
+	// The same settings that arc_welder uses for its source position
+	gcode_position_args args;
+	args.position_buffer_size = 5;
+	args.motion_only = true;
+	args.autodetect_position = true;
+	args.home_x_none = true;
+	args.home_y_none = true;
+	args.home_z_none = true;
+	args.shared_extruder = true;
+	args.zero_based_extruder = true;
+	args.default_extruder = 0;
+	args.xyz_axis_default_mode = "absolute";
+	args.e_axis_default_mode = "absolute";
+	args.units_default = "millimeters";
+	args.location_detection_commands = std::vector<std::string>();
+	args.x_min = -9999;
+	args.x_max = 9999;
+	args.y_min = -9999;
+	args.y_max = 9999;
+	args.z_min = -9999;
+	args.z_max = 9999;
+	return args;
+}
+
+static bool is_move(const parsed_command& command)
+{
+	return command.command == "G0" || command.command == "G1" || command.command == "G2" || command.command == "G3";
+}
+
+static bool has_xyz(const parsed_command& command)
+{
+	for (unsigned int index = 0; index < command.parameters.size(); index++)
+	{
+		const std::string& name = command.parameters[index].name;
+		if (name == "X" || name == "Y" || name == "Z")
+			return true;
+	}
+	return false;
+}
+
+static bool is_position_known(const position& pos)
+{
+	return !pos.x_null && !pos.y_null && !pos.z_null;
+}
+
+static std::string get_parameter_text(const parsed_command_parameter& parameter)
+{
+	std::stringstream text;
+	text << parameter.name;
+	if (parameter.value_type == 'F')
+	{
+		if (parameter.has_fixed_value)
+		{
+			char value[32];
+			text << utilities::fixed_to_string(parameter.fixed_value, FIXED_POINT_DIGITS, value);
+		}
+		else
+		{
+			char value[40];
+			sprintf(value, "%.17g", parameter.double_value);
+			text << value;
+		}
+	}
+	else if (parameter.value_type == 'U')
+		text << parameter.unsigned_long_value;
+	else if (parameter.value_type == 'S')
+		text << parameter.string_value;
+	return text.str();
+}
+
+// Rewrites the source so that every move is relative once the position is known.  X, Y and Z become the distance
+// from the previous position, computed in fixed point so that nothing is rounded.  The G91 goes after the first
+// command that doesn't move X, Y or Z once the position is known, where an arc is unlikely to continue, so that the
+// relative file gives the same arcs as the source.  The source's own G90/G91 are dropped while relative, and G28
+// switches back to absolute until the position is known again.
+static bool write_relative_file(const std::string& source_path, const std::string& target_path)
+{
+	std::ifstream source(source_path.c_str());
+	std::ofstream target(target_path.c_str());
+	if (!source.is_open() || !target.is_open())
+		return false;
+	gcode_parser parser;
+	gcode_position source_position(get_position_args());
+	bool is_relative = false;
+	std::string line;
+	long long line_number = 0;
+	while (std::getline(source, line))
+	{
+		line_number++;
+		parsed_command command;
+		parser.try_parse_gcode(line.c_str(), command, true);
+		position previous = *source_position.get_current_position_ptr();
+		source_position.update(command, line_number, line_number, -1);
+		const position& current = *source_position.get_current_position_ptr();
+		if (is_relative && (command.command == "G90" || command.command == "G91"))
+		{
+			target << ";" << line << "\n";
+			continue;
+		}
+		if (is_relative && command.command == "G28")
+		{
+			target << "G90\n" << line << "\n";
+			is_relative = false;
+			continue;
+		}
+		if (!is_relative || !is_move(command))
+		{
+			target << line << "\n";
+			if (!is_relative && is_position_known(current) && !command.is_empty && (!is_move(command) || !has_xyz(command)))
+			{
+				target << "G91\n";
+				is_relative = true;
+			}
+			continue;
+		}
+		std::string text = command.command;
+		for (unsigned int index = 0; index < command.parameters.size(); index++)
+		{
+			const parsed_command_parameter& parameter = command.parameters[index];
+			long long distance;
+			if (parameter.name == "X")
+				distance = current.x_fixed - previous.x_fixed;
+			else if (parameter.name == "Y")
+				distance = current.y_fixed - previous.y_fixed;
+			else if (parameter.name == "Z")
+				distance = current.z_fixed - previous.z_fixed;
+			else
+			{
+				text += " " + get_parameter_text(parameter);
+				continue;
+			}
+			char value[32];
+			text += " " + parameter.name + utilities::fixed_to_string(distance, FIXED_POINT_DIGITS, value);
+		}
+		target << text;
+		if (command.comment.length() > 0)
+			target << " ;" << command.comment;
+		target << "\n";
+	}
+	return true;
+}
+
+// The absolute end point of every move once the position is known, and the number of arcs in each XYZ mode
+static bool read_end_points(const std::string& path, std::vector<end_point>& end_points, long long& num_absolute_arcs, long long& num_relative_arcs)
+{
+	std::ifstream file(path.c_str());
+	if (!file.is_open())
+		return false;
+	gcode_parser parser;
+	gcode_position file_position(get_position_args());
+	end_points.clear();
+	num_absolute_arcs = 0;
+	num_relative_arcs = 0;
+	std::string line;
+	long long line_number = 0;
+	while (std::getline(file, line))
+	{
+		line_number++;
+		parsed_command command;
+		parser.try_parse_gcode(line.c_str(), command, false);
+		file_position.update(command, line_number, line_number, -1);
+		if (!is_move(command))
+			continue;
+		const position& current = *file_position.get_current_position_ptr();
+		if (command.command == "G2" || command.command == "G3")
+		{
+			if (current.is_relative)
+				num_relative_arcs++;
+			else
+				num_absolute_arcs++;
+		}
+		if (!is_position_known(current))
+			continue;
+		end_point point;
+		point.x = current.x;
+		point.y = current.y;
+		point.z = current.z;
+		point.is_relative = current.is_relative;
+		point.line_number = line_number;
+		end_points.push_back(point);
+	}
+	return true;
+}
+
+static bool is_same_point(const end_point& source, const end_point& output)
+{
+	double tolerance = output.is_relative ? RELATIVE_ARC_TEST_TOLERANCE : RELATIVE_ARC_TEST_ABSOLUTE_TOLERANCE;
+	return std::abs(source.x - output.x) <= tolerance && std::abs(source.y - output.y) <= tolerance &&
+		std::abs(source.z - output.z) <= tolerance;
+}
+
+static std::string describe(const std::string& path, const end_point& point)
+{
+	std::stringstream text;
+	text.precision(10);
+	text << path << ":" << point.line_number << " (X" << point.x << " Y" << point.y << " Z" << point.z << ")";
+	return text.str();
+}
+
+static bool weld(const std::string& source_path, const std::string& target_path, logger* p_logger)
+{
+	arc_welder_args args;
+	args.source_path = source_path;
+	args.target_path = target_path;
+	args.log = p_logger;
+	arc_welder welder(args);
+	arc_welder_results results = welder.process();
+	if (!results.success)
+	{
+		fail("welding " + source_path + " failed: " + results.message);
+		return false;
+	}
+	return true;
+}
+
+static void check_file(const std::string& source_path, const std::string& dir, logger* p_logger, long long min_arcs)
+{
+	std::string relative_path = dir + "/relative_arc_test_relative.gcode";
+	std::string welded_path = dir + "/relative_arc_test_welded.gcode";
+	std::string absolute_welded_path = dir + "/relative_arc_test_absolute_welded.gcode";
+	if (!write_relative_file(source_path, relative_path))
+	{
+		fail("could not rewrite " + source_path);
+		return;
+	}
+	std::vector<end_point> source_points;
+	std::vector<end_point> relative_points;
+	std::vector<end_point> welded_points;
+	std::vector<end_point> absolute_welded_points;
+	long long num_source_absolute_arcs, num_source_relative_arcs;
+	long long num_relative_absolute_arcs, num_relative_relative_arcs;
+	long long num_welded_absolute_arcs, num_welded_relative_arcs;
+	long long num_absolute_welded_absolute_arcs, num_absolute_welded_relative_arcs;
+	if (
+		!weld(relative_path, welded_path, p_logger) || !weld(source_path, absolute_welded_path, p_logger) ||
+		!read_end_points(source_path, source_points, num_source_absolute_arcs, num_source_relative_arcs) ||
+		!read_end_points(relative_path, relative_points, num_relative_absolute_arcs, num_relative_relative_arcs) ||
+		!read_end_points(welded_path, welded_points, num_welded_absolute_arcs, num_welded_relative_arcs) ||
+		!read_end_points(absolute_welded_path, absolute_welded_points, num_absolute_welded_absolute_arcs, num_absolute_welded_relative_arcs)
+	)
+	{
+		fail("could not process " + source_path);
+		return;
+	}
+	remove(relative_path.c_str());
+	remove(welded_path.c_str());
+	remove(absolute_welded_path.c_str());
+
+	// The rewritten file must follow the source exactly, or the rest proves nothing
+	bool is_relative_file_ok = relative_points.size() == source_points.size();
+	for (unsigned int index = 0; is_relative_file_ok && index < source_points.size(); index++)
+	{
+		if (!is_same_point(source_points[index], relative_points[index]))
+		{
+			fail("the relative file leaves the source path at " + describe(source_path, source_points[index]));
+			return;
+		}
+	}
+	if (!is_relative_file_ok)
+	{
+		fail("the relative file has a different number of moves than " + source_path);
+		return;
+	}
+
+	// Every welded end point must be a source end point, in order
+	unsigned int source_index = 0;
+	for (unsigned int index = 0; index < welded_points.size(); index++)
+	{
+		while (source_index < source_points.size() && !is_same_point(source_points[source_index], welded_points[index]))
+			source_index++;
+		if (source_index == source_points.size())
+		{
+			fail("the welded relative file leaves the source path at " + describe("output", welded_points[index]));
+			return;
+		}
+		source_index++;
+	}
+	if (welded_points.empty() != source_points.empty() || (!source_points.empty() && !is_same_point(source_points.back(), welded_points.back())))
+	{
+		fail("the welded relative file does not end where " + source_path + " ends");
+		return;
+	}
+	// The number of arcs can differ a little from the absolute source, since the G91 and tool offsets end an arc
+	// at different points, so it is only reported
+	long long num_new_relative_arcs = num_welded_relative_arcs - num_relative_relative_arcs;
+	long long num_new_arcs = num_new_relative_arcs + num_welded_absolute_arcs - num_relative_absolute_arcs;
+	long long num_new_absolute_source_arcs = (
+		num_absolute_welded_absolute_arcs + num_absolute_welded_relative_arcs - num_source_absolute_arcs - num_source_relative_arcs
+	);
+	if (num_new_relative_arcs < min_arcs)
+	{
+		std::stringstream message;
+		message << source_path << " gives " << num_new_relative_arcs << " relative arcs, expected at least " << min_arcs;
+		fail(message.str());
+		return;
+	}
+	std::cout << "  " << source_path << ": " << source_points.size() << " moves, " << num_new_arcs << " arcs ("
+		<< num_new_relative_arcs << " relative), " << num_new_absolute_source_arcs << " arcs from the absolute source, ok\n";
+}
+
+// Polygons that become arcs, in both directions and at different heights, then a few straight lines
+static void write_polygon_file(const std::string& path)
+{
+	std::ofstream file(path.c_str());
+	file << "G21\nG90\nM82\nG92 E0\nG1 X100.000 Y100.000 Z0.2 F1800\nM106 S255\n";
+	char line[100];
+	double e = 0;
+	for (int layer = 0; layer < 3; layer++)
+	{
+		const int num_segments = 60;
+		const double radius = 15.0 + layer * 2.5;
+		double direction = layer % 2 == 0 ? 1.0 : -1.0;
+		sprintf(line, "G0 X%.3f Y%.3f Z%.2f\n", 100.0 + radius, 100.0, 0.2 + layer * 0.2);
+		file << line;
+		for (int index = 1; index <= num_segments; index++)
+		{
+			double angle = direction * 2.0 * 3.14159265358979323846 * index / num_segments;
+			e += 0.05237;
+			sprintf(line, "G1 X%.3f Y%.3f E%.5f\n", 100.0 + radius * std::cos(angle), 100.0 + radius * std::sin(angle), e);
+			file << line;
+		}
+	}
+	sprintf(line, "G1 X130.125 Y100.000 E%.5f\nG1 X130.125 Y130.250 E%.5f\n", e + 0.5, e + 1.5);
+	file << line;
+	file << "M107\n";
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> logger_names;
+	logger_names.push_back("arc_welder.relative_arc_test");
+	std::vector<int> logger_levels;
+	logger_levels.push_back(WARNING);
+	logger log(logger_names, logger_levels);
+	log.set_log_level(WARNING);
+
+	const char* dir_text = getenv("TMPDIR");
+	std::string dir = dir_text != NULL ? dir_text : "/tmp";
+	std::string polygon_path = dir + "/relative_arc_test_polygons.gcode";
+	write_polygon_file(polygon_path);
+	check_file(polygon_path, dir, &log, 3);
+	remove(polygon_path.c_str());
+	for (int index = 1; index < argc; index++)
+	{
+		check_file(argv[index], dir, &log, 0);
+	}
+	std::cout << (num_failures == 0 ? "relative arc test passed\n" : "relative arc test failed\n");
+	return num_failures == 0 ? 0 : 1;
+}
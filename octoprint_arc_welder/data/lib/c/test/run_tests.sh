@@ -0,0 +1,24 @@
+#!/bin/sh
+# Builds the standalone tests against the library sources and runs each of them on the gcode files given, for example:
+#   ./run_tests.sh ~/gcode/*.gcode
+# BUILD_DIR (default: a temporary directory) holds the binaries, and CXX and CXXFLAGS are used if set.
+TEST_DIR=$(cd "$(dirname "$0")" && pwd)
+LIB_DIR=$(dirname "$TEST_DIR")
+BUILD_DIR=${BUILD_DIR:-$(mktemp -d)}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:--O2 -std=c++11}
+mkdir -p "$BUILD_DIR" || exit 1
+# The welder and the gcode processor library, without the python extension
+LIB_SOURCES="$LIB_DIR/gcode_processor_lib/*.cpp $LIB_DIR/arc_welder/*.cpp"
+failed=0
+for test_source in "$TEST_DIR"/*_test.cpp; do
+	test_name=$(basename "$test_source" .cpp)
+	echo "== $test_name"
+	if ! $CXX $CXXFLAGS -I"$LIB_DIR/gcode_processor_lib" -I"$LIB_DIR/arc_welder" "$test_source" $LIB_SOURCES -o "$BUILD_DIR/$test_name"; then
+		echo "FAIL $test_name did not build"
+		failed=1
+		continue
+	fi
+	"$BUILD_DIR/$test_name" "$@" || failed=1
+done
+exit $failed
@@ -109,6 +109,8 @@ plugin_ignored_packages = []
 # C++ Extension compiler options
 # Set debug mode
 DEBUG = False
+# Count the allocations made in each stage of the arc welder and report them in the results (profiling only)
+COUNT_ALLOCATIONS = False
 # define compiler flags
 compiler_opts = {
     CCompiler.compiler_type: {
@@ -167,6 +169,10 @@ if DEBUG:
         },
     }
 
+if COUNT_ALLOCATIONS:
+    for opts in compiler_opts.values():
+        opts["define_macros"].append(("ARC_WELDER_COUNT_ALLOCATIONS", "1"))
+
 # OS Specific Flags
 os_compiler_opts = {
     'Darwin': {
@@ -230,8 +236,12 @@ plugin_ext_sources = [
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/position.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/utilities.cpp",
     "octoprint_arc_welder/data/lib/c/gcode_processor_lib/logger.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/allocation_counter.cpp",
     "octoprint_arc_welder/data/lib/c/arc_welder/arc_welder.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/point_window.cpp",
     "octoprint_arc_welder/data/lib/c/arc_welder/segmented_arc.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/segmented_bezier.cpp",
+    "octoprint_arc_welder/data/lib/c/arc_welder/segmented_line.cpp",
     "octoprint_arc_welder/data/lib/c/arc_welder/segmented_shape.cpp",
     "octoprint_arc_welder/data/lib/c/py_arc_welder/py_logger.cpp",
     "octoprint_arc_welder/data/lib/c/py_arc_welder/py_arc_welder.cpp",